@@ -5,12 +5,12 @@ int main() {
     if (!tinygui::init(800, 600, "TinyGUI Enhanced Demo")) return -1;
 
     // Char callback for typing (printable characters inserted at caret)
-    glfwSetCharCallback(tinygui::ctx.window, [](GLFWwindow*, unsigned int codepoint){
+    glfwSetCharCallback(tinygui::getWindow(), [](GLFWwindow*, unsigned int codepoint){
         tinygui::onChar(codepoint);
     });
 
     // Key callback for navigation, selection, delete/backspace
-    glfwSetKeyCallback(tinygui::ctx.window, [](GLFWwindow*, int key, int scancode, int action, int mods){
+    glfwSetKeyCallback(tinygui::getWindow(), [](GLFWwindow*, int key, int scancode, int action, int mods){
         tinygui::onKey(key, scancode, action, mods);
     });
     
@@ -53,7 +53,7 @@ int main() {
     }
 
     while (!tinygui::windowShouldClose()) {
-        tinygui::pollEvents();
+        tinygui::waitEvents(); // sleeps until input or the next caret blink
         tinygui::beginFrame();
         
         // Easy menu system - handles everything automatically!
@@ -217,7 +217,7 @@ int main() {
         char statusText[400];
         if (activeSideTab == 1) {
             snprintf(statusText, sizeof(statusText), "Input1: '%s' | Input2: '%s' | Slider: %.2f | Settings Tab: %s | Sidebar: %s", 
-                    input1.text, input2.text, sliderValue, tabNames[activeTab], sideTabNames[activeSideTab]);
+                    input1.text().c_str(), input2.text().c_str(), sliderValue, tabNames[activeTab], sideTabNames[activeSideTab]);
         } else {
             snprintf(statusText, sizeof(statusText), "Sidebar: %s", sideTabNames[activeSideTab]);
         }
@@ -13,6 +13,15 @@
 
 #include <GLFW/glfw3.h>
 
+// Optional: windowless GL contexts for InitOptions::headless
+#ifdef TINYGUI_USE_EGL
+  #include <EGL/egl.h>
+  #include <EGL/eglext.h>
+#endif
+#ifdef TINYGUI_USE_OSMESA
+  #include <GL/osmesa.h>
+#endif
+
 #define STB_EASY_FONT_STATIC
 #define STB_EASY_FONT_IMPLEMENTATION
 #include "stb_easy_font.h"
@@ -22,23 +31,84 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+// TrueType fonts need stb_truetype.h from https://github.com/nothings/stb,
+// unmodified, next to this header. Without it loadFontFromFile() fails and
+// text keeps the built-in font.
+#ifndef TINYGUI_HAS_TRUETYPE
+  #if defined(__has_include)
+    #if __has_include("stb_truetype.h")
+      #define TINYGUI_HAS_TRUETYPE 1
+    #endif
+  #endif
+  #ifndef TINYGUI_HAS_TRUETYPE
+    #define TINYGUI_HAS_TRUETYPE 0
+  #endif
+#endif
+#if TINYGUI_HAS_TRUETYPE
+  #if defined(__GNUC__)
+    #pragma GCC diagnostic push
+    #pragma GCC diagnostic ignored "-Wunused-function"   // STBTT_STATIC: the parts tinygui doesn't call
+  #endif
+  #define STBTT_STATIC
+  #define STB_TRUETYPE_IMPLEMENTATION
+  #include "stb_truetype.h"
+  #if defined(__GNUC__)
+    #pragma GCC diagnostic pop
+  #endif
+#endif
+
 #include <cstring>
+#include <cstdlib>
 #include <cstdio>
 #include <cmath>
+#include <cfloat>
 #include <algorithm>
 #include <map>
+#include <list>
+#include <unordered_map>
 #include <string>
+#include <vector>
+#include <cstddef>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <deque>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #include <emmintrin.h>
+  #define TINYGUI_HAS_SSE2 1
+#else
+  #define TINYGUI_HAS_SSE2 0
+#endif
 
 namespace tinygui {
 
 static constexpr int TINYGUI_MAX_TEXT = 256;
+static constexpr int TINYGUI_INPUT_INLINE = 48;    // input text bytes stored without a heap buffer
+static constexpr size_t TINYGUI_ROPE_CHUNK = 1024;  // most bytes a TextRope node holds
+static constexpr size_t TINYGUI_LINE_MARK_BYTES = 1024;   // text area lines get an x checkpoint about this often
+static constexpr size_t TINYGUI_MARKED_LINES = 256;       // long lines whose checkpoints a text area keeps
 static constexpr float TINYGUI_LABEL_SCALE = 2.0f; // default label scale
+static constexpr int TINYGUI_BATCH_LOOKBACK = 64;  // batches searched when merging out of order
 
 // =============== Color System ===============
 struct Color {
     float r, g, b, a;
     Color(float r = 1.0f, float g = 1.0f, float b = 1.0f, float a = 1.0f) : r(r), g(g), b(b), a(a) {}
     void apply() const { glColor4f(r, g, b, a); }
+    
+    // Pack to bytes R, G, B, A (red in the lowest byte), clamping each channel
+    unsigned int toRGBA8() const {
+        auto byte = [](float f) { return (unsigned int)(std::max(0.0f, std::min(1.0f, f)) * 255.0f + 0.5f); };
+        return byte(r) | (byte(g) << 8) | (byte(b) << 16) | (byte(a) << 24);
+    }
+    static Color fromRGBA8(unsigned int rgba) {
+        return Color((rgba & 0xff) / 255.0f, ((rgba >> 8) & 0xff) / 255.0f,
+                     ((rgba >> 16) & 0xff) / 255.0f, (rgba >> 24) / 255.0f);
+    }
 };
 
 // Predefined colors
@@ -66,21 +136,224 @@ static const Color THEME_SELECTION(0.25f, 0.45f, 0.85f, 1.0f);    // Text select
 static const Color THEME_TEXT(1.0f, 1.0f, 1.0f, 1.0f);            // Normal text
 static const Color THEME_TEXT_DIM(0.7f, 0.7f, 0.7f, 1.0f);        // Disabled/hint text
 
-// Input field state
+// Input field state. The text is a gap buffer: the bytes before and after the
+// gap sit at the two ends of `buf`, so typing at the caret only fills the gap
+// and moving the gap copies just the bytes it passes. Short texts live in
+// `inlineBuf`; longer ones go to a heap buffer that doubles as it fills.
 struct InputState {
-    char text[TINYGUI_MAX_TEXT];
     int caret;
     int selAnchor;
     bool selecting;
     double blinkStart;
     float scrollOffset; // Horizontal scroll offset for long text
     
-    InputState() {
-        text[0] = 0;
-        caret = selAnchor = 0;
-        selecting = false;
-        blinkStart = 0.0;
-        scrollOffset = 0.0f;
+    // Caret positions. charWidths has the same gap layout as the text, with
+    // zeros in the gap, and widthTree is a Fenwick tree over it: an edit
+    // measures only the bytes it inserts and updates the tree in O(log n) per
+    // byte, and widthBefore() sums a prefix in O(log n). input() measures
+    // everything again when the scale or font changed.
+    std::vector<float> charWidths;   // empty = nothing measured
+    std::vector<double> widthTree;   // 1-based; double, so edits don't drift the sums
+    float measuredScale;
+    int measuredFont;
+    std::string visibleText;         // the part of the text input() draws
+    
+    InputState()
+        : caret(0), selAnchor(0), selecting(false), blinkStart(0.0), scrollOffset(0.0f),
+          measuredScale(0.0f), measuredFont(0),
+          buf(inlineBuf), capacity(TINYGUI_INPUT_INLINE), gapStart(0), gapEnd(TINYGUI_INPUT_INLINE) {}
+    InputState(const char* initial) : InputState() { setText(initial); }
+    InputState(const InputState& o) : InputState() { *this = o; }
+    InputState(InputState&& o) noexcept : InputState() { *this = std::move(o); }
+    ~InputState() { if (buf != inlineBuf) delete[] buf; }
+    
+    InputState& operator=(const InputState& o) {
+        if (this == &o) return *this;
+        copyFields(o);
+        if (buf != inlineBuf) delete[] buf;
+        buf = o.buf == o.inlineBuf ? inlineBuf : new char[o.capacity];
+        std::memcpy(buf, o.buf, (size_t)o.capacity);
+        capacity = o.capacity; gapStart = o.gapStart; gapEnd = o.gapEnd;
+        return *this;
+    }
+    InputState& operator=(InputState&& o) noexcept {
+        if (this == &o) return *this;
+        copyFields(o);
+        if (buf != inlineBuf) delete[] buf;
+        if (o.buf == o.inlineBuf) {
+            buf = inlineBuf;
+            std::memcpy(buf, o.buf, (size_t)o.capacity);
+        } else {
+            buf = o.buf;
+            o.buf = o.inlineBuf;
+        }
+        capacity = o.capacity; gapStart = o.gapStart; gapEnd = o.gapEnd;
+        o.capacity = TINYGUI_INPUT_INLINE; o.gapStart = 0; o.gapEnd = TINYGUI_INPUT_INLINE;
+        o.charWidths.clear();
+        o.widthTree.clear();
+        o.caret = o.selAnchor = 0;
+        return *this;
+    }
+    
+    int length() const { return capacity - (gapEnd - gapStart); }
+    bool empty() const { return length() == 0; }
+    char at(int i) const { return buf[physical(i)]; }
+    
+    // NUL-terminated text. Closes the gap at the end first, which copies the
+    // bytes after it, and the next edit before the end copies them back; to
+    // read the text every frame use text() instead.
+    const char* c_str() {
+        moveGap(length());
+        buf[gapStart] = 0;
+        return buf;
+    }
+    
+    // A copy of the text; the gap stays at the caret
+    std::string text() const {
+        std::string out((size_t)length(), '\0');
+        copyText(0, length(), &out[0]);
+        return out;
+    }
+    
+    // Bytes [a, b) into `out`, wherever the gap is
+    void copyText(int a, int b, char* out) const {
+        int before = std::max(0, std::min(b, gapStart) - a);
+        if (before > 0) std::memcpy(out, buf + a, (size_t)before);
+        if (b - a > before) std::memcpy(out + before, buf + physical(a + before), (size_t)(b - a - before));
+    }
+    
+    // Replace the whole text; the caret goes to the end
+    void setText(const char* text) {
+        int n = (int)std::strlen(text);
+        gapStart = 0; gapEnd = capacity;
+        charWidths.clear();
+        widthTree.clear();
+        insertBytes(0, text, n);
+        caret = selAnchor = n;
+    }
+    
+    // Raw edits behind insertInputText()/eraseInputText(). An insert leaves
+    // the gap right after the new bytes, still zero wide until they are
+    // measured; erased bytes join the gap and lose their widths.
+    void insertBytes(int pos, const char* bytes, int n) {
+        moveGap(pos);
+        if (gapEnd - gapStart <= n) grow(n);
+        std::memcpy(buf + gapStart, bytes, (size_t)n);
+        gapStart += n;
+    }
+    void eraseBytes(int a, int b) {
+        // Grow the gap from whichever end it is already closer to
+        int from;
+        if (std::abs(gapStart - b) < std::abs(gapStart - a)) {
+            moveGap(b);
+            gapStart -= b - a;
+            from = gapStart;
+        } else {
+            moveGap(a);
+            from = gapEnd;
+            gapEnd += b - a;
+        }
+        if (!charWidths.empty()) clearWidths(from, b - a);
+    }
+    
+    // Index of byte `i` in the gap layout shared by the text and charWidths
+    int physical(int i) const { return i < gapStart ? i : i + (gapEnd - gapStart); }
+    
+    // Width of the first `i` bytes; the gap adds nothing
+    float widthBefore(int i) const {
+        double sum = 0.0;
+        for (int p = physical(i); p > 0; p &= p - 1) sum += widthTree[p];
+        return (float)sum;
+    }
+    
+    // Width of the byte in slot `p` of the gap layout
+    void setCharWidth(int p, float w) {
+        double delta = (double)w - charWidths[p];
+        charWidths[p] = w;
+        for (int k = p + 1; k < (int)widthTree.size(); k += k & -k) widthTree[k] += delta;
+    }
+    
+    // After charWidths changed wholesale; O(n)
+    void rebuildWidthTree() {
+        int n = (int)charWidths.size();
+        widthTree.assign(n + 1, 0.0);
+        for (int k = 1; k <= n; ++k) {
+            widthTree[k] += charWidths[k - 1];
+            int up = k + (k & -k);
+            if (up <= n) widthTree[up] += widthTree[k];
+        }
+    }
+    
+private:
+    char* buf;
+    int capacity;
+    int gapStart, gapEnd;   // the gap is buf[gapStart, gapEnd)
+    char inlineBuf[TINYGUI_INPUT_INLINE];
+    
+    void copyFields(const InputState& o) {
+        caret = o.caret; selAnchor = o.selAnchor; selecting = o.selecting;
+        blinkStart = o.blinkStart; scrollOffset = o.scrollOffset;
+        charWidths = o.charWidths; widthTree = o.widthTree;
+        measuredScale = o.measuredScale; measuredFont = o.measuredFont;
+    }
+    
+    // Move the bytes between `pos` and the gap across it, with their widths
+    void moveGap(int pos) {
+        bool widths = !charWidths.empty();
+        if (pos < gapStart) {
+            int n = gapStart - pos;
+            std::memmove(buf + gapEnd - n, buf + pos, (size_t)n);
+            if (widths) moveWidths(pos, gapEnd - n, n);
+            gapStart -= n; gapEnd -= n;
+        } else if (pos > gapStart) {
+            int n = pos - gapStart;
+            std::memmove(buf + gapStart, buf + gapEnd, (size_t)n);
+            if (widths) moveWidths(gapEnd, gapStart, n);
+            gapStart += n; gapEnd += n;
+        }
+    }
+    
+    // Widths of `n` slots from `from` to `to`; the slots left behind join the
+    // gap. Short moves update the tree per slot, long ones rebuild it.
+    void moveWidths(int from, int to, int n) {
+        if ((size_t)n * 16 < charWidths.size()) {
+            std::vector<float> moved(charWidths.begin() + from, charWidths.begin() + from + n);
+            for (int i = 0; i < n; ++i) setCharWidth(from + i, 0.0f);
+            for (int i = 0; i < n; ++i) setCharWidth(to + i, moved[i]);
+        } else {
+            std::memmove(&charWidths[to], &charWidths[from], n * sizeof(float));
+            if (to > from) std::fill(&charWidths[from], &charWidths[std::min(from + n, to)], 0.0f);
+            else std::fill(&charWidths[std::max(from, to + n)], &charWidths[from] + n, 0.0f);
+            rebuildWidthTree();
+        }
+    }
+    
+    void clearWidths(int from, int n) {
+        if ((size_t)n * 16 < charWidths.size()) {
+            for (int i = 0; i < n; ++i) setCharWidth(from + i, 0.0f);
+        } else {
+            std::fill(charWidths.begin() + from, charWidths.begin() + from + n, 0.0f);
+            rebuildWidthTree();
+        }
+    }
+    
+    // Make room for `n` more bytes plus the terminator c_str() writes into the gap
+    void grow(int n) {
+        int after = capacity - gapEnd;
+        int newCapacity = std::max(capacity * 2, length() + n + 1);
+        char* grown = new char[newCapacity];
+        std::memcpy(grown, buf, (size_t)gapStart);
+        std::memcpy(grown + newCapacity - after, buf + gapEnd, (size_t)after);
+        if (!charWidths.empty()) {
+            charWidths.resize(newCapacity);
+            std::memmove(&charWidths[newCapacity - after], &charWidths[gapEnd], after * sizeof(float));
+            std::fill(charWidths.begin() + gapStart, charWidths.begin() + (newCapacity - after), 0.0f);
+            rebuildWidthTree();
+        }
+        if (buf != inlineBuf) delete[] buf;
+        buf = grown;
+        capacity = newCapacity;
+        gapEnd = newCapacity - after;
     }
 };
 
@@ -93,21 +366,402 @@ struct ImageData {
     ImageData() : textureID(0), width(0), height(0), loaded(false) {}
 };
 
+// Retained layer behind beginCachedRegion()/endCachedRegion()
+struct CachedRegion {
+    unsigned int texture;          // renderer layer, 0 = none yet
+    float x, y, w, h;
+    int framebufferW, framebufferH;  // layer resolution depends on the window scale
+    unsigned long long hash;       // contents the layer was rendered from
+    bool valid;
+    
+    CachedRegion() : texture(0), x(0), y(0), w(0), h(0), framebufferW(0), framebufferH(0), hash(0), valid(false) {}
+};
+
+// Text of a textArea(): a rope. The document is cut into chunks of at most
+// TINYGUI_ROPE_CHUNK bytes, kept in a treap ordered by position. Each node also
+// sums the bytes and line breaks of its subtree, which makes the tree its own
+// line index: the start of line k and the line of byte i are one descent each.
+// Edits touch one chunk in place when they fit, or split and merge the treap;
+// either way O(log n) plus the chunk size.
+struct TextRope {
+    TextRope() : root(-1), seed(0x9E3779B9u), edits(0) {}
+    
+    size_t size() const { return root < 0 ? 0 : nodes[root].bytes; }
+    size_t lineCount() const { return (root < 0 ? 0 : nodes[root].breaks) + 1; }
+    unsigned long long revision() const { return edits; }   // changes with every edit
+    
+    // Replace the contents; O(n), the treap is built without rebalancing
+    void assign(const char* text, size_t n) {
+        ++edits;
+        nodes.clear();
+        freeNodes.clear();
+        root = build(text, n);
+    }
+    
+    void insert(size_t pos, const char* text, size_t n) {
+        ++edits;
+        pos = std::min(pos, size());
+        if (n == 0 || insertInPlace(root, pos, text, n)) return;
+        int left, right;
+        split(root, pos, left, right);
+        root = merge(merge(left, build(text, n)), right);
+    }
+    
+    void erase(size_t a, size_t b) {
+        ++edits;
+        b = std::min(b, size());
+        if (a >= b || eraseInPlace(root, a, b)) return;
+        int left, middle, right;
+        split(root, a, left, right);
+        split(right, b - a, middle, right);
+        release(middle);
+        root = merge(left, right);
+    }
+    
+    char at(size_t pos) const {
+        int t = root;
+        while (t >= 0) {
+            const Node& n = nodes[t];
+            size_t leftBytes = bytesOf(n.left);
+            if (pos < leftBytes) { t = n.left; continue; }
+            pos -= leftBytes;
+            if (pos < n.text.size()) return n.text[pos];
+            pos -= n.text.size();
+            t = n.right;
+        }
+        return 0;
+    }
+    
+    // Append bytes [a, b) to `out`
+    void copy(size_t a, size_t b, std::string& out) const {
+        b = std::min(b, size());
+        if (a < b) copyRange(root, a, b, out);
+    }
+    
+    std::string str() const {
+        std::string out;
+        out.reserve(size());
+        copy(0, size(), out);
+        return out;
+    }
+    
+    // First byte of `line`; size() past the last line
+    size_t lineStart(size_t line) const {
+        if (line == 0) return 0;
+        if (line >= lineCount()) return size();
+        size_t pos = 0;
+        int t = root;
+        while (t >= 0) {
+            const Node& n = nodes[t];
+            size_t leftBreaks = breaksOf(n.left);
+            if (line <= leftBreaks) { t = n.left; continue; }
+            line -= leftBreaks;
+            pos += bytesOf(n.left);
+            if (line <= n.ownBreaks) {
+                const char* p = n.text.data();
+                for (;;) {
+                    p = (const char*)std::memchr(p, '\n', n.text.data() + n.text.size() - p) + 1;
+                    if (--line == 0) return pos + (size_t)(p - n.text.data());
+                }
+            }
+            line -= n.ownBreaks;
+            pos += n.text.size();
+            t = n.right;
+        }
+        return size();
+    }
+    
+    // Byte after the last character of `line`, i.e. its '\n' or the end
+    size_t lineEnd(size_t line) const {
+        return line + 1 < lineCount() ? lineStart(line + 1) - 1 : size();
+    }
+    
+    size_t lineOf(size_t pos) const {
+        size_t line = 0;
+        int t = root;
+        while (t >= 0) {
+            const Node& n = nodes[t];
+            size_t leftBytes = bytesOf(n.left);
+            if (pos < leftBytes) { t = n.left; continue; }
+            pos -= leftBytes;
+            line += breaksOf(n.left);
+            if (pos <= n.text.size()) return line + (size_t)std::count(n.text.begin(), n.text.begin() + pos, '\n');
+            pos -= n.text.size();
+            line += n.ownBreaks;
+            t = n.right;
+        }
+        return line;
+    }
+    
+private:
+    struct Node {
+        int left, right;
+        unsigned priority;  // max-heap order keeps the treap balanced in expectation
+        size_t bytes;       // subtree totals
+        size_t breaks;
+        size_t ownBreaks;   // line breaks in `text`
+        std::string text;
+    };
+    std::vector<Node> nodes;
+    std::vector<int> freeNodes;
+    int root;
+    unsigned seed;
+    unsigned long long edits;
+    
+    size_t bytesOf(int t) const { return t < 0 ? 0 : nodes[t].bytes; }
+    size_t breaksOf(int t) const { return t < 0 ? 0 : nodes[t].breaks; }
+    
+    static size_t countBreaks(const char* text, size_t n) {
+        return (size_t)std::count(text, text + n, '\n');
+    }
+    
+    void update(int t) {
+        Node& n = nodes[t];
+        n.bytes = bytesOf(n.left) + n.text.size() + bytesOf(n.right);
+        n.breaks = breaksOf(n.left) + n.ownBreaks + breaksOf(n.right);
+    }
+    
+    unsigned nextPriority() {
+        seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;  // xorshift32
+        return seed;
+    }
+    
+    int newNode(const char* text, size_t n, unsigned priority) {
+        int t;
+        if (!freeNodes.empty()) { t = freeNodes.back(); freeNodes.pop_back(); }
+        else { t = (int)nodes.size(); nodes.emplace_back(); }
+        Node& node = nodes[t];
+        node.left = node.right = -1;
+        node.priority = priority;
+        node.text.assign(text, n);
+        node.ownBreaks = countBreaks(text, n);
+        update(t);
+        return t;
+    }
+    
+    void release(int t) {
+        if (t < 0) return;
+        release(nodes[t].left);
+        release(nodes[t].right);
+        std::string().swap(nodes[t].text);
+        freeNodes.push_back(t);
+    }
+    
+    // Chunks of `text` as a treap: a Cartesian tree over random priorities,
+    // built left to right with a stack of the rightmost path
+    int build(const char* text, size_t n) {
+        std::vector<int> path;
+        for (size_t at = 0; at < n; at += TINYGUI_ROPE_CHUNK) {
+            int t = newNode(text + at, std::min(TINYGUI_ROPE_CHUNK, n - at), nextPriority());
+            int last = -1;
+            while (!path.empty() && nodes[path.back()].priority < nodes[t].priority) {
+                last = path.back();
+                path.pop_back();
+                update(last);
+            }
+            nodes[t].left = last;
+            if (!path.empty()) nodes[path.back()].right = t;
+            path.push_back(t);
+        }
+        for (size_t i = path.size(); i-- > 0; ) update(path[i]);
+        return path.empty() ? -1 : path[0];
+    }
+    
+    int merge(int a, int b) {
+        if (a < 0) return b;
+        if (b < 0) return a;
+        if (nodes[a].priority >= nodes[b].priority) {
+            int right = merge(nodes[a].right, b);
+            nodes[a].right = right;
+            update(a);
+            return a;
+        }
+        int left = merge(a, nodes[b].left);
+        nodes[b].left = left;
+        update(b);
+        return b;
+    }
+    
+    // `a` gets the first `pos` bytes of `t`, `b` the rest; a chunk straddling
+    // `pos` is cut in two
+    void split(int t, size_t pos, int& a, int& b) {
+        if (t < 0) { a = b = -1; return; }
+        size_t leftBytes = bytesOf(nodes[t].left);
+        size_t own = nodes[t].text.size();
+        if (pos <= leftBytes) {
+            int left;
+            split(nodes[t].left, pos, a, left);
+            nodes[t].left = left;
+            update(t);
+            b = t;
+        } else if (pos >= leftBytes + own) {
+            int right;
+            split(nodes[t].right, pos - leftBytes - own, right, b);
+            nodes[t].right = right;
+            update(t);
+            a = t;
+        } else {
+            // The tail takes this node's priority, so it still outranks the right subtree
+            size_t cut = pos - leftBytes;
+            std::string tail = nodes[t].text.substr(cut);
+            int r = newNode(tail.data(), tail.size(), nodes[t].priority);
+            nodes[t].text.resize(cut);
+            nodes[t].ownBreaks -= nodes[r].ownBreaks;
+            nodes[r].right = nodes[t].right;
+            nodes[t].right = -1;
+            update(t);
+            update(r);
+            a = t;
+            b = r;
+        }
+    }
+    
+    // Typing: insert into the chunk at `pos` when it has room
+    bool insertInPlace(int t, size_t pos, const char* text, size_t n) {
+        if (t < 0) return false;
+        size_t leftBytes = bytesOf(nodes[t].left);
+        size_t own = nodes[t].text.size();
+        bool done;
+        if (pos < leftBytes) done = insertInPlace(nodes[t].left, pos, text, n);
+        else if (pos <= leftBytes + own) {
+            done = own + n <= TINYGUI_ROPE_CHUNK;
+            if (done) {
+                nodes[t].text.insert(pos - leftBytes, text, n);
+                nodes[t].ownBreaks += countBreaks(text, n);
+            }
+        } else done = insertInPlace(nodes[t].right, pos - leftBytes - own, text, n);
+        if (done) update(t);
+        return done;
+    }
+    
+    // Deleting within one chunk that keeps some of its bytes
+    bool eraseInPlace(int t, size_t a, size_t b) {
+        if (t < 0) return false;
+        size_t leftBytes = bytesOf(nodes[t].left);
+        size_t own = nodes[t].text.size();
+        bool done;
+        if (b <= leftBytes) done = eraseInPlace(nodes[t].left, a, b);
+        else if (a >= leftBytes + own) done = eraseInPlace(nodes[t].right, a - leftBytes - own, b - leftBytes - own);
+        else {
+            done = a >= leftBytes && b <= leftBytes + own && b - a < own;
+            if (done) {
+                nodes[t].ownBreaks -= countBreaks(nodes[t].text.data() + (a - leftBytes), b - a);
+                nodes[t].text.erase(a - leftBytes, b - a);
+            }
+        }
+        if (done) update(t);
+        return done;
+    }
+    
+    void copyRange(int t, size_t a, size_t b, std::string& out) const {
+        if (t < 0 || a >= b) return;
+        const Node& n = nodes[t];
+        size_t leftBytes = bytesOf(n.left);
+        size_t own = n.text.size();
+        if (a < leftBytes) copyRange(n.left, a, std::min(b, leftBytes), out);
+        size_t from = std::max(a, leftBytes), to = std::min(b, leftBytes + own);
+        if (from < to) out.append(n.text, from - leftBytes, to - from);
+        if (b > leftBytes + own) copyRange(n.right, a > leftBytes + own ? a - leftBytes - own : 0, b - leftBytes - own, out);
+    }
+};
+
 // Multi-line text area state
 struct TextAreaState {
-    char text[TINYGUI_MAX_TEXT * 4]; // Larger buffer for multi-line
-    int caret;
-    int selAnchor;
+    TextRope text;
+    size_t caret;
+    size_t selAnchor;
     bool selecting;
     double blinkStart;
-    float scrollY;
+    double scrollX;         // pixels from the line starts; a single line can be tens of MB wide too
+    double scrollY;         // pixels from the top; a float runs out of precision in long documents
+    double scrollTargetY;   // scrollY eases toward this
+    double scrollTime;      // when the easing last stepped
+    double goalX;           // x that up/down moves keep, -1 = none
+    bool followCaret;       // scroll the caret into view on the next frame
+    bool draggingThumb;
+    float thumbGrab;        // where on the scrollbar thumb the drag started
+    int pageLines;          // lines visible in the last frame, for page up/down
+    std::string lineText;   // the part of a line being drawn
+    
+    // x checkpoints along lines longer than TINYGUI_LINE_MARK_BYTES, so that
+    // finding a byte's x (or an x's byte) walks from the nearest one rather
+    // than from the line start. Each sits on a character boundary; valid for
+    // one font and scale, and for text up to the first byte edited since.
+    struct LineMarks {
+        std::vector<size_t> offset;     // bytes from the line start, first one 0
+        std::vector<double> x;
+        unsigned long long used;        // marksClock when last looked up
+    };
+    std::map<size_t, LineMarks> lineMarks;  // by line start
+    unsigned long long marksRevision;       // text.revision() they match
+    int marksFont;                          // Font::id, 0 = stb_easy_font
+    float marksScale;
+    unsigned long long marksClock;
     
     TextAreaState() {
-        text[0] = 0;
         caret = selAnchor = 0;
         selecting = false;
         blinkStart = 0.0;
-        scrollY = 0.0f;
+        scrollX = 0.0;
+        scrollY = scrollTargetY = 0.0;
+        scrollTime = 0.0;
+        goalX = -1.0;
+        followCaret = false;
+        draggingThumb = false;
+        thumbGrab = 0.0f;
+        pageLines = 1;
+        marksRevision = 0;
+        marksFont = 0;
+        marksScale = 0.0f;
+        marksClock = 0;
+    }
+    
+    // Replace the document; the caret goes to the start
+    void setText(const char* data, size_t size) {
+        text.assign(data, size);
+        caret = selAnchor = 0;
+        scrollX = 0.0;
+        scrollY = scrollTargetY = 0.0;
+        goalX = -1.0;
+    }
+    void setText(const char* data) { setText(data, std::strlen(data)); }
+    std::string str() const { return text.str(); }
+    
+    // Edit the document. These keep the checkpoints before the edit; changing
+    // `text` directly works too but drops them all.
+    void insert(size_t pos, const char* data, size_t n) {
+        bool synced = marksRevision == text.revision();
+        pos = std::min(pos, text.size());
+        text.insert(pos, data, n);
+        if (synced) shiftMarks(pos, 0, n);
+    }
+    void erase(size_t a, size_t b) {
+        bool synced = marksRevision == text.revision();
+        b = std::min(b, text.size());
+        text.erase(a, b);
+        if (synced && a < b) shiftMarks(a, b - a, 0);
+        else if (synced) marksRevision = text.revision();
+    }
+    
+private:
+    // `removed` bytes at `pos` became `added` ones: lines after the edit move,
+    // the edited line keeps its checkpoints before `pos`, lines it swallowed go
+    void shiftMarks(size_t pos, size_t removed, size_t added) {
+        std::map<size_t, LineMarks> kept;
+        for (auto& entry : lineMarks) {
+            size_t start = entry.first;
+            LineMarks& marks = entry.second;
+            if (start <= pos) {
+                size_t keep = std::lower_bound(marks.offset.begin() + 1, marks.offset.end(), pos - start) - marks.offset.begin();
+                marks.offset.resize(keep);
+                marks.x.resize(keep);
+                kept[start] = std::move(marks);
+            } else if (start > pos + removed) {
+                kept[start - removed + added] = std::move(marks);
+            }
+        }
+        lineMarks.swap(kept);
+        marksRevision = text.revision();
     }
 };
 
@@ -126,117 +780,3174 @@ struct ModalState {
     }
 };
 
-struct Context {
-    GLFWwindow* window;
-    float mouseX, mouseY;
-    bool mouseDown;
-    bool mousePressed;
-    
-    // Active input field
-    InputState* activeInput;
+// ==================== Draw List ====================
+// Widgets never talk to OpenGL directly: they append geometry to the frame's
+// DrawList between beginFrame() and endFrame(). Consecutive primitives that
+// share state are merged into one batch, and each batch costs one draw call.
+// Vertices are 12 bytes: positions in quarter units, texture coords in
+// 1/16384ths (exact for any power-of-two texture up to 16384 texels) and the
+// color packed as RGBA8. Use the accessors rather than the raw fields.
+// Positions therefore reach +-TINYGUI_VERTEX_LIMIT (8191.75) units and texture
+// coords +-2.0; quantizeVertex() clamps anything past that. Clamping an
+// untextured rect just clips it, but it would move a textured or slanted
+// corner on its own, so setQuad() and drawLine() clip those geometrically first.
+static constexpr float TINYGUI_VERTEX_SUBPIXELS = 4.0f;
+static constexpr float TINYGUI_VERTEX_UV_ONE = 16384.0f;
+static constexpr float TINYGUI_VERTEX_LIMIT = 32767.0f / TINYGUI_VERTEX_SUBPIXELS;
+
+struct Vertex {
+    short x, y;
+    short u, v;          // texture coords, ignored for untextured batches
+    unsigned int color;  // RGBA8, see Color::toRGBA8()
     
-    // Layout state
-    float layoutX, layoutY;  // Current layout position
-    float layoutSpacing;     // Space between widgets
-    bool layoutVertical;     // Layout direction
+    float posX() const { return x * (1.0f / TINYGUI_VERTEX_SUBPIXELS); }
+    float posY() const { return y * (1.0f / TINYGUI_VERTEX_SUBPIXELS); }
+    float texU() const { return u * (1.0f / TINYGUI_VERTEX_UV_ONE); }
+    float texV() const { return v * (1.0f / TINYGUI_VERTEX_UV_ONE); }
+    Color getColor() const { return Color::fromRGBA8(color); }
+};
+static_assert(sizeof(Vertex) == 12, "Vertex should pack to 12 bytes");
+
+// Axis-aligned clip rect in window coords, top-left origin
+struct ClipRect {
+    float x, y, w, h;
     
-    // Menu system state
-    bool menuBarVisible;
-    int activeMenu;          // -1 = none, 0+ = menu index
-    int hoveredMenu;         // -1 = none, 0+ = menu index
-    float menuBarHeight;
-    int pendingMenuResult;   // Store menu result for automatic handling
+    ClipRect(float x = 0, float y = 0, float w = 0, float h = 0) : x(x), y(y), w(w), h(h) {}
+    bool operator==(const ClipRect& o) const { return x == o.x && y == o.y && w == o.w && h == o.h; }
+    bool operator!=(const ClipRect& o) const { return !(*this == o); }
+    bool empty() const { return w <= 0 || h <= 0; }
     
-    // Image system
-    std::map<std::string, ImageData> imageCache;
+    ClipRect intersect(const ClipRect& o) const {
+        float x0 = std::max(x, o.x), y0 = std::max(y, o.y);
+        float x1 = std::min(x + w, o.x + o.w), y1 = std::min(y + h, o.y + o.h);
+        return ClipRect(x0, y0, std::max(0.0f, x1 - x0), std::max(0.0f, y1 - y0));
+    }
     
-    // Modal dialog system
-    ModalState modal;
+    // True when the box [x0,x1]x[y0,y1] has no overlap with this rect
+    bool rejects(float x0, float y0, float x1, float y1) const {
+        return x1 <= x || y1 <= y || x0 >= x + w || y0 >= y + h;
+    }
 };
 
-static Context ctx;
+// Lines and outlines are emitted as quads too (see drawLine), so they share
+// batches with the fills around them
+enum PrimitiveType {
+    PRIM_QUADS   // 4 vertices per quad
+};
 
-// ============== Helpers for text editing ==============
-inline int textLen(InputState* input) {
-    if (!input) return 0;
-    return (int)std::strlen(input->text);
-}
+struct DrawBatch {
+    PrimitiveType prim;
+    unsigned int texture;   // 0 = untextured (drawn with the white-pixel texture)
+    ClipRect clip;          // scissor applied to the whole batch
+    int first, count;       // vertex range in DrawList::vertices
+    
+    // Batches with equal state can be drawn with one call
+    bool sameState(const DrawBatch& o) const {
+        return prim == o.prim && texture == o.texture && clip == o.clip;
+    }
+};
 
-inline int clampIndex(int i, InputState* input) {
-    int len = textLen(input);
-    return std::max(0, std::min(i, len));
+// 64-bit FNV-1a over 32-bit words; Vertex and DrawBatch are all 4-byte fields
+inline unsigned long long hashWords(const void* data, size_t bytes, unsigned long long h = 14695981039346656037ull) {
+    const unsigned int* words = (const unsigned int*)data;
+    for (size_t i = 0, n = bytes / 4; i < n; ++i) {
+        h ^= words[i];
+        h *= 1099511628211ull;
+    }
+    return h;
 }
 
-inline bool hasSelection(InputState* input) {
-    if (!input) return false;
-    return input->caret != input->selAnchor;
+// 64-bit FNV-1a over the bytes of a string
+inline unsigned long long hashText(const char* text, unsigned long long h = 14695981039346656037ull) {
+    for (const unsigned char* p = (const unsigned char*)text; *p; ++p) {
+        h ^= *p;
+        h *= 1099511628211ull;
+    }
+    return h;
 }
 
-inline void resetBlink(InputState* input) {
-    if (!input) return;
-    input->blinkStart = glfwGetTime();
+struct DrawList {
+    std::vector<Vertex> vertices;
+    std::vector<DrawBatch> batches;
+    std::vector<char> scratch;  // stb_easy_font output, reused between labels
+    
+    // Clip applied to newly recorded geometry (top of Context::clipStack)
+    ClipRect clip;
+    
+    // Output of sortBatches(): merged batches over a regrouped vertex array
+    std::vector<Vertex> sortedVertices;
+    std::vector<DrawBatch> sortedBatches;
+    std::vector<ClipRect> groupBounds;
+    std::vector<int> groupTail, batchNext;
+    size_t sealed;  // batches before this index are never extended
+    
+    DrawList() : sealed(0) {}
+    
+    void clear(const ClipRect& root) {
+        vertices.clear();   // keeps capacity, so steady-state frames do not allocate
+        batches.clear();
+        clip = root;
+        sealed = 0;
+    }
+    
+    // Start a fresh batch for the next geometry, so it can be cut out later
+    void seal() {
+        sealed = batches.size();
+    }
+    
+    // Reserve `count` vertices, extending the last batch when its state matches
+    Vertex* alloc(PrimitiveType prim, int count, unsigned int texture = 0) {
+        DrawBatch batch;
+        batch.prim = prim;
+        batch.texture = texture;
+        batch.clip = clip;
+        batch.first = (int)vertices.size();
+        batch.count = 0;
+        if (batches.size() <= sealed || !batches.back().sameState(batch)) batches.push_back(batch);
+        batches.back().count += count;
+        size_t base = vertices.size();
+        vertices.resize(base + count);
+        return &vertices[base];
+    }
+    
+    // Screen area a batch can touch: vertex bounds limited by its clip
+    ClipRect bounds(const DrawBatch& batch) const {
+        const Vertex* v = &vertices[batch.first];
+        float x0 = v->posX(), y0 = v->posY(), x1 = x0, y1 = y0;
+        for (int i = 1; i < batch.count; ++i) {
+            x0 = std::min(x0, v[i].posX()); x1 = std::max(x1, v[i].posX());
+            y0 = std::min(y0, v[i].posY()); y1 = std::max(y1, v[i].posY());
+        }
+        return ClipRect(x0, y0, x1 - x0, y1 - y0).intersect(batch.clip);
+    }
+    
+    // Identifies the recorded frame; equal hashes mean identical output
+    unsigned long long hash() const {
+        unsigned long long h = hashWords(vertices.data(), vertices.size() * sizeof(Vertex));
+        return hashWords(batches.data(), batches.size() * sizeof(DrawBatch), h);
+    }
+    
+    // Merge batches with identical state (texture, clip, primitive) even when
+    // other batches were recorded in between, as long as none of those overlap
+    // the batch being moved, so painter's order is preserved where it matters.
+    // Returns false when nothing merged and `batches`/`vertices` can be drawn as is.
+    bool sortBatches() {
+        sortedBatches.clear();
+        groupBounds.clear();
+        groupTail.clear();
+        batchNext.assign(batches.size(), -1);
+        
+        bool merged = false;
+        for (int i = 0; i < (int)batches.size(); ++i) {
+            const DrawBatch& batch = batches[i];
+            ClipRect area = bounds(batch);
+            int target = -1;
+            int stop = std::max(0, (int)sortedBatches.size() - TINYGUI_BATCH_LOOKBACK);
+            for (int g = (int)sortedBatches.size() - 1; g >= stop; --g) {
+                if (sortedBatches[g].sameState(batch)) { target = g; break; }
+                const ClipRect& gb = groupBounds[g];
+                if (!gb.rejects(area.x, area.y, area.x + area.w, area.y + area.h)) break; // would draw over it
+            }
+            if (target < 0) {
+                sortedBatches.push_back(batch);  // `first` is the head batch index until emission
+                sortedBatches.back().first = i;
+                groupBounds.push_back(area);
+                groupTail.push_back(i);
+            } else {
+                batchNext[groupTail[target]] = i;
+                groupTail[target] = i;
+                ClipRect& gb = groupBounds[target];
+                float x0 = std::min(gb.x, area.x), y0 = std::min(gb.y, area.y);
+                float x1 = std::max(gb.x + gb.w, area.x + area.w), y1 = std::max(gb.y + gb.h, area.y + area.h);
+                gb = ClipRect(x0, y0, x1 - x0, y1 - y0);
+                merged = true;
+            }
+        }
+        if (!merged) return false;
+        
+        // Lay each group out contiguously so it is a single draw call
+        sortedVertices.resize(vertices.size());
+        int out = 0;
+        for (DrawBatch& group : sortedBatches) {
+            int first = out;
+            for (int i = group.first; i >= 0; i = batchNext[i]) {
+                const DrawBatch& batch = batches[i];
+                std::memcpy(&sortedVertices[out], &vertices[batch.first], batch.count * sizeof(Vertex));
+                out += batch.count;
+            }
+            group.first = first;
+            group.count = out - first;
+        }
+        return true;
+    }
+};
+
+// Round half up (not half away from zero) so quantizing commutes with
+// translating by whole quarter units, and clamp to the int16 range
+inline short quantizeVertex(float f, float unitsPerOne) {
+    float q = std::floor(f * unitsPerOne + 0.5f);
+    return (short)std::max(-32768.0f, std::min(32767.0f, q));
 }
 
-inline void setCaret(InputState* input, int pos, bool keepSelection) {
-    if (!input) return;
-    pos = clampIndex(pos, input);
-    input->caret = pos;
-    if (!keepSelection) input->selAnchor = pos;
-    resetBlink(input);
+inline void setVertex(Vertex* v, float x, float y, float u, float vv, const Color& color) {
+    v->x = quantizeVertex(x, TINYGUI_VERTEX_SUBPIXELS);
+    v->y = quantizeVertex(y, TINYGUI_VERTEX_SUBPIXELS);
+    v->u = quantizeVertex(u, TINYGUI_VERTEX_UV_ONE);
+    v->v = quantizeVertex(vv, TINYGUI_VERTEX_UV_ONE);
+    v->color = color.toRGBA8();
 }
 
-inline void deleteSelectionRange(InputState* input) {
-    if (!input || !hasSelection(input)) return;
-    int a = std::min(input->selAnchor, input->caret);
-    int b = std::max(input->selAnchor, input->caret);
-    int len = textLen(input);
-    std::memmove(input->text + a, input->text + b, (size_t)(len - b + 1)); // include null terminator
-    input->caret = input->selAnchor = a;
-    resetBlink(input);
+// Shift an already-quantized vertex by whole quarter units
+inline void offsetVertex(Vertex* v, int dx, int dy) {
+    v->x = (short)std::max(-32768, std::min(32767, v->x + dx));
+    v->y = (short)std::max(-32768, std::min(32767, v->y + dy));
 }
 
-// Compute per-character widths and cumulative positions
-// Returns length actually processed.
-inline int computeCharWidths(const char* text, float scale,
-                            float* charWidths, float* cumWidths, int maxChars,
-                            float* outTotalWidth) {
-    int len = (int)std::strlen(text);
-    if (len > maxChars) len = maxChars;
+// Per-frame rendering statistics, filled in by endFrame()
+struct FrameStats {
+    int drawCalls;
+    int batches;
+    int vertices;
+    bool skipped;   // identical to the previous frame: nothing submitted or presented
+    int damageRects;   // regions redrawn; one covering the screen on full redraws
+    float damageArea;  // logical px^2 redrawn
+    int stateCallsAvoided;   // GL state changes the renderer skipped as redundant
+    int textMeasureHits;     // text sizes answered by the measurement cache while building the frame
+    int textMeasureMisses;   // text sizes measured glyph by glyph
+    
+    FrameStats() : drawCalls(0), batches(0), vertices(0), skipped(false), damageRects(0), damageArea(0), stateCallsAvoided(0),
+                   textMeasureHits(0), textMeasureMisses(0) {}
+};
 
-    float totalWidth = 0.0f;
-    for (int i = 0; i < len; ++i) {
-        // Get character width from stb_easy_font character info
-        unsigned char c = text[i];
-        if (c >= 32 && c < 128) {
-            // Get advance width (bottom 4 bits) and add spacing
-            float charWidth = (stb_easy_font_charinfo[c - 32].advance & 15) * scale;
-            charWidth += stb_easy_font_spacing_val * scale;
-            charWidths[i] = charWidth;
+// ==================== Damage Tracking ====================
+// The screen is split into cells and every primitive is hashed into the cells
+// its bounds touch, in draw order. Cells whose hash differs from the last
+// presented frame are merged into a few rects; only those get redrawn.
+static constexpr int TINYGUI_DAMAGE_CELL = 64;
+static constexpr int TINYGUI_MAX_DAMAGE_RECTS = 8;
+
+struct DamageTracker {
+    int width, height;   // logical target size the cells cover
+    int framebufferW, framebufferH;
+    int cols, rows;
+    std::vector<unsigned long long> cells, previous;
+    std::vector<unsigned char> forced;
+    std::vector<ClipRect> rects;   // this frame's damage, logical units
+    bool valid;                    // previous holds a presented frame of this size
+    
+    DamageTracker() : width(0), height(0), framebufferW(0), framebufferH(0), cols(0), rows(0), valid(false) {}
+    
+    void addPrim(const Vertex* v, int n, const DrawBatch& batch) {
+        float x0 = v[0].posX(), y0 = v[0].posY(), x1 = x0, y1 = y0;
+        for (int i = 1; i < n; ++i) {
+            x0 = std::min(x0, v[i].posX()); x1 = std::max(x1, v[i].posX());
+            y0 = std::min(y0, v[i].posY()); y1 = std::max(y1, v[i].posY());
+        }
+        // Pixel coverage rounds outward, so pad the box
+        float pad = 1.0f;
+        ClipRect box = ClipRect(x0 - pad, y0 - pad, x1 - x0 + 2 * pad, y1 - y0 + 2 * pad).intersect(batch.clip);
+        if (box.empty()) return;
+        
+        // Vertices plus batch state; the vertex range itself shifts between frames
+        unsigned long long h = hashWords(v, n * sizeof(Vertex));
+        h = hashWords(&batch, offsetof(DrawBatch, first), h);
+        int c0 = std::max(0, (int)(box.x / TINYGUI_DAMAGE_CELL));
+        int r0 = std::max(0, (int)(box.y / TINYGUI_DAMAGE_CELL));
+        int c1 = std::min(cols - 1, (int)((box.x + box.w) / TINYGUI_DAMAGE_CELL));
+        int r1 = std::min(rows - 1, (int)((box.y + box.h) / TINYGUI_DAMAGE_CELL));
+        for (int r = r0; r <= r1; ++r)
+            for (int c = c0; c <= c1; ++c)
+                cells[r * cols + c] = hashWords(&h, sizeof(h), cells[r * cols + c]);
+    }
+    
+    // Fill rects with the regions that changed; empty means nothing did.
+    // `changed` are areas whose pixels changed without their geometry changing.
+    void update(const DrawList& list, int w, int h, int fbW, int fbH, const std::vector<ClipRect>& changed) {
+        if (fbW != framebufferW || fbH != framebufferH) {
+            framebufferW = fbW; framebufferH = fbH;
+            valid = false;
+        }
+        if (w != width || h != height) {
+            width = w; height = h;
+            cols = (w + TINYGUI_DAMAGE_CELL - 1) / TINYGUI_DAMAGE_CELL;
+            rows = (h + TINYGUI_DAMAGE_CELL - 1) / TINYGUI_DAMAGE_CELL;
+            valid = false;
+        }
+        cells.assign((size_t)cols * rows, 14695981039346656037ull);
+        for (const DrawBatch& batch : list.batches) {
+            for (int i = 0; i + 4 <= batch.count; i += 4) addPrim(&list.vertices[batch.first + i], 4, batch);
+        }
+        forced.assign(cells.size(), 0);
+        for (const ClipRect& rect : changed) {
+            int c0 = std::max(0, (int)(rect.x / TINYGUI_DAMAGE_CELL));
+            int r0 = std::max(0, (int)(rect.y / TINYGUI_DAMAGE_CELL));
+            int c1 = std::min(cols - 1, (int)((rect.x + rect.w) / TINYGUI_DAMAGE_CELL));
+            int r1 = std::min(rows - 1, (int)((rect.y + rect.h) / TINYGUI_DAMAGE_CELL));
+            for (int r = r0; r <= r1; ++r)
+                for (int c = c0; c <= c1; ++c) forced[r * cols + c] = 1;
+        }
+        auto dirty = [this](int i) { return forced[i] || cells[i] != previous[i]; };
+        
+        rects.clear();
+        if (!valid) {
+            rects.push_back(ClipRect(0, 0, (float)w, (float)h));
         } else {
-            charWidths[i] = 0.0f; // Invalid character
+            // Runs of dirty cells per row, extended downward while the next row has the same run
+            for (int r = 0; r < rows; ++r) {
+                for (int c = 0; c < cols; ) {
+                    if (!dirty(r * cols + c)) { ++c; continue; }
+                    int start = c;
+                    while (c < cols && dirty(r * cols + c)) ++c;
+                    bool merged = false;
+                    for (ClipRect& rect : rects) {
+                        if (rect.x == start && rect.w == c - start && rect.y + rect.h == r) {
+                            rect.h += 1;
+                            merged = true;
+                            break;
+                        }
+                    }
+                    if (!merged) rects.push_back(ClipRect((float)start, (float)r, (float)(c - start), 1));
+                }
+            }
+            // Too fragmented: one bounding rect
+            if ((int)rects.size() > TINYGUI_MAX_DAMAGE_RECTS) {
+                ClipRect box = rects[0];
+                for (const ClipRect& rect : rects) {
+                    float x1 = std::max(box.x + box.w, rect.x + rect.w), y1 = std::max(box.y + box.h, rect.y + rect.h);
+                    box.x = std::min(box.x, rect.x); box.y = std::min(box.y, rect.y);
+                    box.w = x1 - box.x; box.h = y1 - box.y;
+                }
+                rects.assign(1, box);
+            }
+            ClipRect screen(0, 0, (float)w, (float)h);
+            float area = 0;
+            for (ClipRect& rect : rects) {
+                rect = ClipRect(rect.x * TINYGUI_DAMAGE_CELL, rect.y * TINYGUI_DAMAGE_CELL,
+                                rect.w * TINYGUI_DAMAGE_CELL, rect.h * TINYGUI_DAMAGE_CELL).intersect(screen);
+                area += rect.w * rect.h;
+            }
+            // Every rect replays all batches; past half the screen one pass is cheaper
+            if (rects.size() > 1 && area * 2 > screen.w * screen.h) rects.assign(1, screen);
         }
-        cumWidths[i] = totalWidth;
-        totalWidth += charWidths[i];
+        previous.swap(cells);
+        valid = true;
     }
+};
+
+// ==================== Label Cache ====================
+// label() geometry keyed on text, scale and color, kept relative to the label
+// origin. A hit copies the vertices and offsets them; stb_easy_font is skipped.
+static constexpr size_t TINYGUI_LABEL_CACHE_BUDGET = 4 << 20;  // default bytes of cached vertices
+
+struct LabelCacheStats {
+    unsigned long long hits, misses, evictions;
+    size_t bytes;     // vertex bytes currently cached
+    size_t entries;
     
-    if (outTotalWidth) *outTotalWidth = totalWidth;
-    return len;
-}
+    LabelCacheStats() : hits(0), misses(0), evictions(0), bytes(0), entries(0) {}
+};
 
-// ==================== Initialization ====================
-inline bool init(int w, int h, const char* title) {
-    if (!glfwInit()) return false;
-    ctx.window = glfwCreateWindow(w, h, title, NULL, NULL);
-    if (!ctx.window) return false;
+struct LabelCache {
+    struct Entry {
+        unsigned long long key;
+        std::string text;   // guards against hash collisions
+        float scale;
+        Color color;
+        std::vector<Vertex> vertices;
+    };
     
-    // Set minimum window size to 800x600
-    glfwSetWindowSizeLimits(ctx.window, 800, 600, GLFW_DONT_CARE, GLFW_DONT_CARE);
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<unsigned long long, std::list<Entry>::iterator> index;
+    size_t budget;
+    LabelCacheStats stats;
     
-    glfwMakeContextCurrent(ctx.window);
-
-    ctx.mouseX = ctx.mouseY = 0;
+    LabelCache() : budget(TINYGUI_LABEL_CACHE_BUDGET) {}
+    
+    static unsigned long long keyOf(const char* text, float scale, const Color& color) {
+        unsigned long long h = hashWords(&scale, sizeof(scale), hashText(text));
+        return hashWords(&color, sizeof(color), h);
+    }
+    
+    static size_t entryBytes(const Entry& e) {
+        return e.vertices.size() * sizeof(Vertex) + e.text.size();
+    }
+    
+    // Cached vertices for this label, or null; counts the hit or miss
+    const std::vector<Vertex>* find(unsigned long long key, const char* text, float scale, const Color& color) {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            const Entry& e = *it->second;
+            if (e.scale == scale && e.color.r == color.r && e.color.g == color.g && e.color.b == color.b &&
+                e.color.a == color.a && e.text == text) {
+                entries.splice(entries.begin(), entries, it->second);
+                ++stats.hits;
+                return &e.vertices;
+            }
+        }
+        ++stats.misses;
+        return nullptr;
+    }
+    
+    // Takes ownership of freshly tessellated vertices; labels larger than the budget are not kept
+    void insert(unsigned long long key, const char* text, float scale, const Color& color, std::vector<Vertex>& vertices) {
+        auto it = index.find(key);
+        if (it != index.end()) erase(it->second);   // collision: newest wins
+        Entry e;
+        e.key = key; e.text = text; e.scale = scale; e.color = color;
+        e.vertices.swap(vertices);
+        size_t bytes = entryBytes(e);
+        if (bytes > budget) return;
+        entries.push_front(std::move(e));
+        index[key] = entries.begin();
+        stats.bytes += bytes;
+        stats.entries = entries.size();
+        trim();
+    }
+    
+    void erase(std::list<Entry>::iterator it) {
+        stats.bytes -= entryBytes(*it);
+        index.erase(it->key);
+        entries.erase(it);
+        stats.entries = entries.size();
+    }
+    
+    // Evict least recently used labels until the cache fits the budget
+    void trim() {
+        while (stats.bytes > budget && !entries.empty()) {
+            erase(std::prev(entries.end()));
+            ++stats.evictions;
+        }
+    }
+};
+
+// ==================== Text Measurement Cache ====================
+// Widgets measure the same few strings every frame for layout and centering.
+// Each distinct string is measured once per font and kept in font units, so
+// every scale shares the entry; later lookups cost one hash of the text.
+static constexpr size_t TINYGUI_TEXT_METRICS_ENTRIES = 4096;  // strings kept before the cache starts over
+
+struct TextMetricsStats {
+    unsigned long long hits, misses;   // since init()
+    size_t entries;
+    
+    TextMetricsStats() : hits(0), misses(0), entries(0) {}
+};
+
+struct TextMetricsCache {
+    struct Entry {
+        std::string text;   // guards against hash collisions
+        int font;           // Font::id that measured it; 0 = stb_easy_font
+        float width;        // widest line, in font units
+        float height;       // lines times the line pitch, in the same units
+    };
+    
+    std::unordered_map<unsigned long long, Entry> entries;
+    TextMetricsStats stats;
+    int frameHits, frameMisses;   // since the last frame was submitted
+    
+    TextMetricsCache() : frameHits(0), frameMisses(0) {}
+    
+    static unsigned long long keyOf(const char* text, int font) {
+        return hashWords(&font, sizeof(font), hashText(text));
+    }
+    
+    // Cached sizes for this string, or null; counts the hit or miss
+    const Entry* find(unsigned long long key, const char* text, int font) {
+        auto it = entries.find(key);
+        if (it != entries.end() && it->second.font == font && it->second.text == text) {
+            ++stats.hits; ++frameHits;
+            return &it->second;
+        }
+        ++stats.misses; ++frameMisses;
+        return nullptr;
+    }
+    
+    // Changing strings (counters, input text) would grow the map without
+    // bound, so a full cache is simply emptied; the steady set refills in a frame
+    void insert(unsigned long long key, const char* text, int font, float width, float height) {
+        if (entries.size() >= TINYGUI_TEXT_METRICS_ENTRIES) entries.clear();
+        Entry& e = entries[key];   // collision: newest wins
+        e.text = text; e.font = font; e.width = width; e.height = height;
+        stats.entries = entries.size();
+    }
+};
+
+// ==================== Renderer Interface ====================
+// The widget layer only records into the DrawList. endFrame() hands the sorted
+// batches to one Renderer, which is the only code that talks to a graphics API.
+enum RenderBackend {
+    BACKEND_GL_FIXED,  // OpenGL 1.x fixed-function pipeline (default, always available)
+    BACKEND_GL_CORE,   // OpenGL 3.3 core profile, falls back to BACKEND_GL_FIXED
+    BACKEND_SOFTWARE,  // headless CPU rasterizer into an RGBA8 buffer, no window or GL
+    BACKEND_NULL       // headless, draws nothing; for benchmarking the CPU side
+};
+
+// Destination of one frame
+struct FrameTarget {
+    int displayW, displayH;          // logical units used by the draw list
+    int framebufferW, framebufferH;  // pixels
+    Color clearColor;
+    const std::vector<ClipRect>* damage;  // logical regions to clear and redraw; null = everything
+    
+    FrameTarget(int displayW = 0, int displayH = 0, int framebufferW = 0, int framebufferH = 0, const Color& clearColor = Color())
+        : displayW(displayW), displayH(displayH), framebufferW(framebufferW), framebufferH(framebufferH),
+          clearColor(clearColor), damage(nullptr) {}
+};
+
+// Pixels of one presented frame, RGBA8 with the top row first
+struct FrameImage {
+    int width, height;
+    unsigned long long frame;   // endFrame() count when the readback was requested
+    std::vector<unsigned char> rgba;
+    
+    FrameImage() : width(0), height(0), frame(0) {}
+};
+
+struct Renderer {
+    virtual ~Renderer() {}
+    // Create an RGBA8 texture; the id goes in DrawBatch::texture. 0 = failure.
+    virtual unsigned int uploadTexture(const unsigned char* rgba, int width, int height) = 0;
+    // Size and clear the target
+    virtual void beginFrame(const FrameTarget& target) = 0;
+    // Clip following geometry to a rect in logical units
+    virtual void setClip(const ClipRect& clip) = 0;
+    // Draw batches in order, each under its own clip; returns the draw calls issued
+    virtual int submit(const std::vector<DrawBatch>& batches, const Vertex* vertices) = 0;
+    // Show the finished frame
+    virtual void present() = 0;
+    virtual void shutdown() {}
+    // True when pixels outside FrameTarget::damage survive until the next frame
+    virtual bool preservesContents() const { return false; }
+    virtual void releaseTexture(unsigned int) {}
+    // Overwrite a w*h RGBA8 rect of a texture at (x, y), top row first
+    virtual void updateTexture(unsigned int, int, int, int, int, const unsigned char*) {}
+    // Redundant state changes filtered since the last call, for backends that cache GL state
+    virtual int takeAvoidedStateCalls() { return 0; }
+    // Forget cached GL state because other code may have changed it
+    virtual void invalidateState() {}
+    
+    // Offscreen layers for cached regions: draw batches (logical coords) inside
+    // `region` into a texture at framebuffer resolution, over frame.clearColor.
+    // Pass 0 to create the texture. Returns its id, or 0 if unsupported.
+    virtual unsigned int renderLayer(unsigned int, const ClipRect&, const FrameTarget&,
+                                     const std::vector<DrawBatch>&, const Vertex*) { return 0; }
+    // True when renderLayer() can succeed
+    virtual bool supportsLayers() const { return false; }
+    // GL textures store the bottom row first, so layer quads flip V
+    virtual bool layerRowsBottomUp() const { return false; }
+    
+    // Start copying the last presented frame out without waiting for it. The
+    // copy finishes in the background; takeReadback() returns the oldest one
+    // once it has, or blocks for it when `wait` is set.
+    virtual void readback(unsigned long long) {}
+    virtual bool takeReadback(FrameImage&, bool) { return false; }
+};
+
+// Accepts everything and draws nothing, so frames cost only the widget layer
+// and batching
+struct NullRenderer : Renderer {
+    unsigned int textureCount;
+    
+    NullRenderer() : textureCount(0) {}
+    
+    unsigned int uploadTexture(const unsigned char*, int, int) override { return ++textureCount; }
+    void beginFrame(const FrameTarget&) override {}
+    void setClip(const ClipRect&) override {}
+    int submit(const std::vector<DrawBatch>& batches, const Vertex*) override { return (int)batches.size(); }
+    void present() override {}
+    bool preservesContents() const override { return true; }
+    unsigned int renderLayer(unsigned int layer, const ClipRect&, const FrameTarget&,
+                             const std::vector<DrawBatch>&, const Vertex*) override { return layer ? layer : ++textureCount; }
+    bool supportsLayers() const override { return true; }
+};
+
+// ==================== OpenGL Fixed-Function Backend ====================
+#ifndef APIENTRY
+  #define APIENTRY
+#endif
+
+// Entry points beyond GL 1.1 come from glfwGetProcAddress, or from the EGL or
+// OSMesa loader while init() sets up a windowless context; no loader library needed
+typedef void* (*GLProcLoader)(const char* name);
+
+inline GLProcLoader& glProcLoader() {
+    static thread_local GLProcLoader loader = nullptr;
+    return loader;
+}
+
+inline void* getGLProc(const char* name) {
+    GLProcLoader loader = glProcLoader();
+    return loader ? loader(name) : (void*)glfwGetProcAddress(name);
+}
+
+#define TINYGUI_LOAD_GL(name) \
+    if (!(*(void**)&name = getGLProc("gl" #name))) return false;
+
+#define TINYGUI_GL_CLAMP_TO_EDGE    0x812F
+#define TINYGUI_GL_RGBA8            0x8058
+#define TINYGUI_GL_FRAMEBUFFER      0x8D40
+#define TINYGUI_GL_READ_FRAMEBUFFER 0x8CA8
+#define TINYGUI_GL_DRAW_FRAMEBUFFER 0x8CA9
+#define TINYGUI_GL_COLOR_ATTACHMENT0 0x8CE0
+#define TINYGUI_GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#define TINYGUI_GL_PIXEL_PACK_BUFFER 0x88EB
+#define TINYGUI_GL_STREAM_READ      0x88E1
+#define TINYGUI_GL_READ_ONLY        0x88B8
+#define TINYGUI_GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define TINYGUI_GL_TIMEOUT_EXPIRED  0x911B
+
+// GL 3.0 / ARB_framebuffer_object, used to keep the previous frame for partial redraws
+struct GLFramebufferFunctions {
+    void (APIENTRY *GenFramebuffers)(GLsizei n, GLuint* ids);
+    void (APIENTRY *DeleteFramebuffers)(GLsizei n, const GLuint* ids);
+    void (APIENTRY *BindFramebuffer)(GLenum target, GLuint id);
+    void (APIENTRY *FramebufferTexture2D)(GLenum target, GLenum attachment, GLenum texTarget, GLuint texture, GLint level);
+    GLenum (APIENTRY *CheckFramebufferStatus)(GLenum target);
+    void (APIENTRY *BlitFramebuffer)(GLint sx0, GLint sy0, GLint sx1, GLint sy1, GLint dx0, GLint dy0, GLint dx1, GLint dy1,
+                                     GLbitfield mask, GLenum filter);
+    
+    bool load() {
+        TINYGUI_LOAD_GL(GenFramebuffers) TINYGUI_LOAD_GL(DeleteFramebuffers) TINYGUI_LOAD_GL(BindFramebuffer)
+        TINYGUI_LOAD_GL(FramebufferTexture2D) TINYGUI_LOAD_GL(CheckFramebufferStatus) TINYGUI_LOAD_GL(BlitFramebuffer)
+        return true;
+    }
+};
+
+// GL 2.1 pixel pack buffers, so glReadPixels returns before the copy is done,
+// and GL 3.2 / ARB_sync fences to ask whether it is. Fences are optional.
+struct GLReadbackFunctions {
+    void (APIENTRY *GenBuffers)(GLsizei n, GLuint* ids);
+    void (APIENTRY *DeleteBuffers)(GLsizei n, const GLuint* ids);
+    void (APIENTRY *BindBuffer)(GLenum target, GLuint id);
+    void (APIENTRY *BufferData)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+    void* (APIENTRY *MapBuffer)(GLenum target, GLenum access);
+    GLboolean (APIENTRY *UnmapBuffer)(GLenum target);
+    // GLsync is an opaque pointer
+    void* (APIENTRY *FenceSync)(GLenum condition, GLbitfield flags);
+    GLenum (APIENTRY *ClientWaitSync)(void* sync, GLbitfield flags, unsigned long long timeout);
+    void (APIENTRY *DeleteSync)(void* sync);
+    
+    bool load() {
+        if (!loadFences()) FenceSync = nullptr;
+        TINYGUI_LOAD_GL(GenBuffers) TINYGUI_LOAD_GL(DeleteBuffers) TINYGUI_LOAD_GL(BindBuffer)
+        TINYGUI_LOAD_GL(BufferData) TINYGUI_LOAD_GL(MapBuffer) TINYGUI_LOAD_GL(UnmapBuffer)
+        return true;
+    }
+    
+    bool loadFences() {
+        TINYGUI_LOAD_GL(FenceSync) TINYGUI_LOAD_GL(ClientWaitSync) TINYGUI_LOAD_GL(DeleteSync)
+        return true;
+    }
+};
+
+// Shadow copy of the GL state the renderers change. Setters compare against it
+// and only reach GL on real transitions; `avoided` counts the calls filtered
+// out. invalidate() forgets everything, e.g. after other code used the context.
+struct GLStateCache {
+    enum { CAP_BLEND, CAP_TEXTURE_2D, CAP_SCISSOR, CAP_ARRAYS, CAP_COUNT };
+    signed char caps[CAP_COUNT];   // -1 = unknown
+    GLenum blendSrc, blendDst;
+    GLuint texture;
+    bool textureKnown;
+    int box[4];                    // scissor box; box[2] < 0 = unknown
+    int avoided;
+    
+    GLStateCache() : avoided(0) { invalidate(); }
+    
+    void invalidate() {
+        for (signed char& cap : caps) cap = -1;
+        blendSrc = blendDst = 0;
+        texture = 0;
+        textureKnown = false;
+        box[0] = box[1] = 0; box[2] = box[3] = -1;
+    }
+    
+    bool changed(signed char& known, bool on) {
+        if (known == (signed char)on) { ++avoided; return false; }
+        known = on;
+        return true;
+    }
+    
+    void enable(int cap, bool on) {
+        static const GLenum names[] = {GL_BLEND, GL_TEXTURE_2D, GL_SCISSOR_TEST};
+        if (!changed(caps[cap], on)) return;
+        if (cap == CAP_ARRAYS) {
+            // The fixed-function path's interleaved position/texcoord/color stream
+            if (on) {
+                glEnableClientState(GL_VERTEX_ARRAY);
+                glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+                glEnableClientState(GL_COLOR_ARRAY);
+            } else {
+                glDisableClientState(GL_COLOR_ARRAY);
+                glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+                glDisableClientState(GL_VERTEX_ARRAY);
+            }
+        } else if (on) {
+            glEnable(names[cap]);
+        } else {
+            glDisable(names[cap]);
+        }
+    }
+    
+    void blendFunc(GLenum src, GLenum dst) {
+        if (src == blendSrc && dst == blendDst) { ++avoided; return; }
+        blendSrc = src; blendDst = dst;
+        glBlendFunc(src, dst);
+    }
+    
+    void bindTexture(GLuint id) {
+        if (textureKnown && id == texture) { ++avoided; return; }
+        texture = id; textureKnown = true;
+        glBindTexture(GL_TEXTURE_2D, id);
+    }
+    
+    // Deleting the bound texture rebinds 0 behind our back
+    void forgetTexture(GLuint id) {
+        if (texture == id) textureKnown = false;
+    }
+    
+    void scissor(int x, int y, int w, int h) {
+        if (box[0] == x && box[1] == y && box[2] == w && box[3] == h) { ++avoided; return; }
+        box[0] = x; box[1] = y; box[2] = w; box[3] = h;
+        glScissor(x, y, w, h);
+    }
+};
+
+struct ScissorState {
+    ClipRect screen;   // clips equal to this need no scissor test
+    float sx, sy;      // logical -> framebuffer pixels
+    int fbH;
+    
+    ScissorState() : sx(1.0f), sy(1.0f), fbH(0) {}
+    
+    // `view` is the logical rect mapped onto the fbW x fbH viewport
+    void reset(const ClipRect& view, int fbW, int fbH, GLStateCache& state) {
+        screen = view;
+        sx = view.w > 0 ? fbW / view.w : 1.0f;
+        sy = view.h > 0 ? fbH / view.h : 1.0f;
+        this->fbH = fbH;
+        state.enable(GLStateCache::CAP_SCISSOR, false);
+    }
+    
+    void apply(const ClipRect& clip, GLStateCache& state) {
+        bool want = clip != screen;
+        state.enable(GLStateCache::CAP_SCISSOR, want);
+        if (want) {
+            // Batches use top-left logical coords; GL scissor is bottom-left framebuffer pixels
+            float cx = clip.x - screen.x, cy = clip.y - screen.y;
+            int x0 = (int)std::floor(cx * sx), x1 = (int)std::ceil((cx + clip.w) * sx);
+            int y0 = (int)std::floor(cy * sy), y1 = (int)std::ceil((cy + clip.h) * sy);
+            state.scissor(x0, fbH - y1, x1 - x0, y1 - y0);
+        }
+    }
+};
+
+static constexpr int TINYGUI_READBACK_DEPTH = 3;  // default pixel buffers in the readback ring
+
+// GL rows run bottom to top; FrameImage rows top to bottom
+inline void copyRowsFlipped(const unsigned char* bottomUp, FrameImage& image) {
+    size_t row = (size_t)image.width * 4;
+    image.rgba.resize(row * image.height);
+    for (int y = 0; y < image.height; ++y) {
+        std::memcpy(&image.rgba[row * y], bottomUp + row * (image.height - 1 - y), row);
+    }
+}
+
+// Default renderer: client-side vertex arrays, one glDrawArrays per batch.
+// Frames are drawn into an offscreen color buffer and blitted to the window, so
+// undamaged pixels are still valid next frame (the back buffer is undefined
+// after a swap).
+struct GLRenderer : Renderer {
+    GLFWwindow* window;
+    GLuint whiteTexture;   // 1x1 white texel bound for untextured geometry
+    GLStateCache state;
+    FrameTarget target;
+    ScissorState scissor;
+    std::vector<ClipRect> passes;   // damage rects this frame; batches are drawn once per rect
+    GLFramebufferFunctions fb;
+    GLuint framebuffer, colorTexture;  // 0 when FBOs are unavailable: full redraws only
+    GLuint layerFramebuffer;           // target for cached-region layers
+    int bufferW, bufferH;
+    
+    // Frame readbacks, oldest first. Each copies into one of a ring of pixel
+    // buffers and is done once its fence signals; without pixel buffers it is
+    // done at once. A new copy with the ring full first maps the oldest.
+    struct Readback {
+        GLuint buffer;                  // 0 once the pixels are in `image`
+        void* fence;
+        unsigned long long presents;    // present() count when issued; without fences, one more frame means done
+        FrameImage image;
+    };
+    GLReadbackFunctions rb;
+    bool pixelBuffers;
+    std::deque<Readback> readbacks;
+    std::vector<GLuint> spareBuffers;
+    int readbackDepth;                  // ring size
+    unsigned long long presents;
+    
+    GLRenderer() : window(nullptr), whiteTexture(0), framebuffer(0), colorTexture(0), layerFramebuffer(0),
+                   bufferW(0), bufferH(0), pixelBuffers(false), readbackDepth(TINYGUI_READBACK_DEPTH), presents(0) {}
+    
+    // Needs the window's context to be current. Without a window (EGL or
+    // OSMesa headless) frames stay in the offscreen buffer for readback().
+    bool init(GLFWwindow* w) {
+        window = w;
+        if (fb.load()) fb.GenFramebuffers(1, &framebuffer);
+        pixelBuffers = rb.load();
+        // Untextured geometry samples a white texel, so switching between images
+        // and fills is just a bind
+        const unsigned char white[4] = {255, 255, 255, 255};
+        glGenTextures(1, &whiteTexture);
+        state.bindTexture(whiteTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        return true;
+    }
+    
+    void shutdown() override {
+        if (whiteTexture) glDeleteTextures(1, &whiteTexture);
+        if (colorTexture) glDeleteTextures(1, &colorTexture);
+        if (framebuffer) fb.DeleteFramebuffers(1, &framebuffer);
+        if (layerFramebuffer) fb.DeleteFramebuffers(1, &layerFramebuffer);
+        whiteTexture = colorTexture = framebuffer = layerFramebuffer = 0;
+        for (Readback& r : readbacks) {
+            if (r.buffer) spareBuffers.push_back(r.buffer);
+            if (r.fence) rb.DeleteSync(r.fence);
+        }
+        readbacks.clear();
+        if (!spareBuffers.empty()) rb.DeleteBuffers((GLsizei)spareBuffers.size(), spareBuffers.data());
+        spareBuffers.clear();
+    }
+    
+    bool preservesContents() const override { return framebuffer != 0; }
+    bool supportsLayers() const override { return framebuffer != 0; }
+    
+    // (Re)allocate the offscreen buffer at the framebuffer size
+    void resizeBuffer(int w, int h) {
+        if (!framebuffer || (w == bufferW && h == bufferH)) return;
+        if (!colorTexture) glGenTextures(1, &colorTexture);
+        state.bindTexture(colorTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexImage2D(GL_TEXTURE_2D, 0, TINYGUI_GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        fb.BindFramebuffer(TINYGUI_GL_FRAMEBUFFER, framebuffer);
+        fb.FramebufferTexture2D(TINYGUI_GL_FRAMEBUFFER, TINYGUI_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+        if (fb.CheckFramebufferStatus(TINYGUI_GL_FRAMEBUFFER) != TINYGUI_GL_FRAMEBUFFER_COMPLETE) {
+            printf("TinyGUI: offscreen framebuffer incomplete, partial redraw disabled\n");
+            fb.BindFramebuffer(TINYGUI_GL_FRAMEBUFFER, 0);
+            fb.DeleteFramebuffers(1, &framebuffer);
+            glDeleteTextures(1, &colorTexture);
+            framebuffer = colorTexture = 0;
+            return;
+        }
+        bufferW = w; bufferH = h;
+    }
+    
+    unsigned int uploadTexture(const unsigned char* rgba, int width, int height) override {
+        GLuint texture = 0;
+        glGenTextures(1, &texture);
+        state.bindTexture(texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, TINYGUI_GL_CLAMP_TO_EDGE); // GL_CLAMP is not core
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, TINYGUI_GL_CLAMP_TO_EDGE);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+        return texture;
+    }
+    
+    void releaseTexture(unsigned int texture) override {
+        GLuint id = texture;
+        glDeleteTextures(1, &id);
+        state.forgetTexture(id);
+    }
+    
+    void updateTexture(unsigned int texture, int x, int y, int w, int h, const unsigned char* rgba) override {
+        state.bindTexture(texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    }
+    
+    bool layerRowsBottomUp() const override { return true; }
+    
+    // Same pipeline as a frame, aimed at a texture. The layer keeps the window's
+    // orientation so lines rasterize onto the same pixels as when drawn directly.
+    unsigned int renderLayer(unsigned int layer, const ClipRect& region, const FrameTarget& frame,
+                             const std::vector<DrawBatch>& batches, const Vertex* verts) override {
+        if (!framebuffer) return 0;
+        float sx = frame.displayW > 0 ? (float)frame.framebufferW / frame.displayW : 1.0f;
+        float sy = frame.displayH > 0 ? (float)frame.framebufferH / frame.displayH : 1.0f;
+        int w = std::max(1, (int)std::ceil(region.w * sx)), h = std::max(1, (int)std::ceil(region.h * sy));
+        if (!layer) layer = uploadTexture(nullptr, w, h);
+        if (!layerFramebuffer) fb.GenFramebuffers(1, &layerFramebuffer);
+        fb.BindFramebuffer(TINYGUI_GL_FRAMEBUFFER, layerFramebuffer);
+        fb.FramebufferTexture2D(TINYGUI_GL_FRAMEBUFFER, TINYGUI_GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer, 0);
+        
+        glViewport(0, 0, w, h);
+        glClearColor(frame.clearColor.r, frame.clearColor.g, frame.clearColor.b, frame.clearColor.a);
+        scissor.reset(region, w, h, state);
+        glClear(GL_COLOR_BUFFER_BIT);
+        state.enable(GLStateCache::CAP_BLEND, true);
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        passes.assign(1, region);
+        if (!batches.empty()) submit(batches, verts);
+        fb.BindFramebuffer(TINYGUI_GL_FRAMEBUFFER, 0);
+        return layer;
+    }
+    
+    void beginFrame(const FrameTarget& frame) override {
+        target = frame;
+        resizeBuffer(frame.framebufferW, frame.framebufferH);
+        if (framebuffer) fb.BindFramebuffer(TINYGUI_GL_FRAMEBUFFER, framebuffer);
+        // Use framebuffer size for viewport (pixels)
+        glViewport(0, 0, frame.framebufferW, frame.framebufferH);
+        glClearColor(frame.clearColor.r, frame.clearColor.g, frame.clearColor.b, frame.clearColor.a);
+        scissor.reset(ClipRect(0, 0, (float)frame.displayW, (float)frame.displayH), frame.framebufferW, frame.framebufferH, state);
+        if (frame.damage && framebuffer) {
+            passes = *frame.damage;
+        } else {
+            passes.assign(1, scissor.screen);
+        }
+        for (const ClipRect& pass : passes) {
+            setClip(pass);
+            glClear(GL_COLOR_BUFFER_BIT);
+        }
+        state.enable(GLStateCache::CAP_BLEND, true);
+        state.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+    
+    void setClip(const ClipRect& clip) override {
+        scissor.apply(clip, state);
+    }
+    
+    void bindTexture(unsigned int texture) {
+        state.bindTexture(texture ? texture : whiteTexture);
+    }
+    
+    int takeAvoidedStateCalls() override {
+        int n = state.avoided;
+        state.avoided = 0;
+        return n;
+    }
+    
+    void invalidateState() override {
+        state.invalidate();
+    }
+    
+    int submit(const std::vector<DrawBatch>& batches, const Vertex* base) override {
+        const ClipRect& view = scissor.screen;
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        // Top-left origin, Y down, in window units
+        glOrtho(view.x, view.x + view.w, view.y + view.h, view.y, -1, 1);
+        
+        // Vertices carry fixed-point positions and texture coords; scale them back here
+        glMatrixMode(GL_TEXTURE);
+        glLoadIdentity();
+        glScalef(1.0f / TINYGUI_VERTEX_UV_ONE, 1.0f / TINYGUI_VERTEX_UV_ONE, 1.0f);
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        glScalef(1.0f / TINYGUI_VERTEX_SUBPIXELS, 1.0f / TINYGUI_VERTEX_SUBPIXELS, 1.0f);
+        
+        // Texturing and arrays stay set between frames; the cache skips them
+        state.enable(GLStateCache::CAP_TEXTURE_2D, true);
+        
+        // One interleaved stream for every batch
+        state.enable(GLStateCache::CAP_ARRAYS, true);
+        glVertexPointer(2, GL_SHORT, sizeof(Vertex), &base->x);
+        glTexCoordPointer(2, GL_SHORT, sizeof(Vertex), &base->u);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), &base->color);
+        
+        int drawCalls = 0;
+        for (const ClipRect& pass : passes) {
+            for (const DrawBatch& batch : batches) {
+                ClipRect clip = batch.clip.intersect(pass);
+                if (clip.empty()) continue;
+                setClip(clip);
+                bindTexture(batch.texture);
+                glDrawArrays(GL_QUADS, batch.first, batch.count);
+                drawCalls++;
+            }
+        }
+        
+        setClip(scissor.screen);
+        return drawCalls;
+    }
+    
+    void present() override {
+        if (framebuffer) {
+            if (window) {
+                fb.BindFramebuffer(TINYGUI_GL_READ_FRAMEBUFFER, framebuffer);
+                fb.BindFramebuffer(TINYGUI_GL_DRAW_FRAMEBUFFER, 0);
+                fb.BlitFramebuffer(0, 0, bufferW, bufferH, 0, 0, bufferW, bufferH, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            }
+            fb.BindFramebuffer(TINYGUI_GL_FRAMEBUFFER, 0);
+        }
+        if (window) glfwSwapBuffers(window);
+        else glFlush();
+        ++presents;
+    }
+    
+    // The offscreen buffer holds the last frame; without one, the front buffer
+    // does after the swap
+    void readback(unsigned long long frame) override {
+        int w = framebuffer ? bufferW : target.framebufferW;
+        int h = framebuffer ? bufferH : target.framebufferH;
+        if (w <= 0 || h <= 0) return;
+        // Ring full; the oldest copies are frames old, so this rarely waits
+        int inFlight = 0;
+        for (const Readback& r : readbacks) inFlight += r.buffer != 0;
+        for (Readback& r : readbacks) {
+            if (inFlight < readbackDepth) break;
+            if (r.buffer) { finishReadback(r); --inFlight; }
+        }
+        
+        Readback r;
+        r.buffer = 0;
+        r.fence = nullptr;
+        r.presents = presents;
+        r.image.width = w; r.image.height = h;
+        r.image.frame = frame;
+        if (framebuffer) fb.BindFramebuffer(TINYGUI_GL_READ_FRAMEBUFFER, framebuffer);
+        else if (window) glReadBuffer(GL_FRONT);
+        if (pixelBuffers) {
+            if (spareBuffers.empty()) {
+                GLuint id = 0;
+                rb.GenBuffers(1, &id);
+                spareBuffers.push_back(id);
+            }
+            r.buffer = spareBuffers.back();
+            spareBuffers.pop_back();
+            rb.BindBuffer(TINYGUI_GL_PIXEL_PACK_BUFFER, r.buffer);
+            rb.BufferData(TINYGUI_GL_PIXEL_PACK_BUFFER, (ptrdiff_t)w * h * 4, NULL, TINYGUI_GL_STREAM_READ);
+            glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, NULL);  // queued; returns at once
+            rb.BindBuffer(TINYGUI_GL_PIXEL_PACK_BUFFER, 0);
+            if (rb.FenceSync) r.fence = rb.FenceSync(TINYGUI_GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();  // so the fence can signal without another frame
+        } else {
+            std::vector<unsigned char> rows((size_t)w * h * 4);
+            glReadPixels(0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, rows.data());
+            copyRowsFlipped(rows.data(), r.image);
+        }
+        if (framebuffer) fb.BindFramebuffer(TINYGUI_GL_READ_FRAMEBUFFER, 0);
+        else if (window) glReadBuffer(GL_BACK);
+        readbacks.push_back(std::move(r));
+    }
+    
+    // Map the pixel buffer (blocking if the copy is still running) and take its rows
+    void finishReadback(Readback& r) {
+        if (!r.buffer) return;
+        rb.BindBuffer(TINYGUI_GL_PIXEL_PACK_BUFFER, r.buffer);
+        if (const void* rows = rb.MapBuffer(TINYGUI_GL_PIXEL_PACK_BUFFER, TINYGUI_GL_READ_ONLY)) {
+            copyRowsFlipped((const unsigned char*)rows, r.image);
+            rb.UnmapBuffer(TINYGUI_GL_PIXEL_PACK_BUFFER);
+        }
+        rb.BindBuffer(TINYGUI_GL_PIXEL_PACK_BUFFER, 0);
+        if (r.fence) rb.DeleteSync(r.fence);
+        spareBuffers.push_back(r.buffer);
+        r.buffer = 0;
+        r.fence = nullptr;
+    }
+    
+    bool takeReadback(FrameImage& out, bool wait) override {
+        if (readbacks.empty()) return false;
+        Readback& r = readbacks.front();
+        if (r.buffer && !wait) {
+            bool done = r.fence ? rb.ClientWaitSync(r.fence, 0, 0) != TINYGUI_GL_TIMEOUT_EXPIRED : presents > r.presents;
+            if (!done) return false;
+        }
+        finishReadback(r);
+        out = std::move(r.image);
+        readbacks.pop_front();
+        return true;
+    }
+};
+
+// ==================== OpenGL 3.3 Core Backend ====================
+// Optional renderer for core-profile contexts: one shader program, an
+// orthographic projection uniform, and every quad drawn as an instance of a
+// unit quad. Entry points are loaded through glfwGetProcAddress so no loader
+// library is needed.
+#define TINYGUI_GL_ARRAY_BUFFER     0x8892
+#define TINYGUI_GL_STREAM_DRAW      0x88E0
+#define TINYGUI_GL_STATIC_DRAW      0x88E4
+#define TINYGUI_GL_FRAGMENT_SHADER  0x8B30
+#define TINYGUI_GL_VERTEX_SHADER    0x8B31
+#define TINYGUI_GL_COMPILE_STATUS   0x8B81
+#define TINYGUI_GL_LINK_STATUS      0x8B82
+#define TINYGUI_GL_TEXTURE0         0x84C0
+
+struct GLCoreFunctions {
+    GLuint (APIENTRY *CreateShader)(GLenum type);
+    void (APIENTRY *ShaderSource)(GLuint shader, GLsizei count, const char* const* src, const GLint* len);
+    void (APIENTRY *CompileShader)(GLuint shader);
+    void (APIENTRY *GetShaderiv)(GLuint shader, GLenum pname, GLint* params);
+    void (APIENTRY *GetShaderInfoLog)(GLuint shader, GLsizei size, GLsizei* len, char* log);
+    void (APIENTRY *DeleteShader)(GLuint shader);
+    GLuint (APIENTRY *CreateProgram)();
+    void (APIENTRY *AttachShader)(GLuint program, GLuint shader);
+    void (APIENTRY *LinkProgram)(GLuint program);
+    void (APIENTRY *GetProgramiv)(GLuint program, GLenum pname, GLint* params);
+    void (APIENTRY *GetProgramInfoLog)(GLuint program, GLsizei size, GLsizei* len, char* log);
+    void (APIENTRY *DeleteProgram)(GLuint program);
+    void (APIENTRY *UseProgram)(GLuint program);
+    GLint (APIENTRY *GetUniformLocation)(GLuint program, const char* name);
+    void (APIENTRY *UniformMatrix4fv)(GLint loc, GLsizei count, GLboolean transpose, const GLfloat* value);
+    void (APIENTRY *Uniform1i)(GLint loc, GLint value);
+    void (APIENTRY *GenVertexArrays)(GLsizei n, GLuint* arrays);
+    void (APIENTRY *BindVertexArray)(GLuint array);
+    void (APIENTRY *DeleteVertexArrays)(GLsizei n, const GLuint* arrays);
+    void (APIENTRY *GenBuffers)(GLsizei n, GLuint* buffers);
+    void (APIENTRY *BindBuffer)(GLenum target, GLuint buffer);
+    void (APIENTRY *BufferData)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+    void (APIENTRY *DeleteBuffers)(GLsizei n, const GLuint* buffers);
+    void (APIENTRY *EnableVertexAttribArray)(GLuint index);
+    void (APIENTRY *VertexAttribPointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* ptr);
+    void (APIENTRY *VertexAttribDivisor)(GLuint index, GLuint divisor);
+    void (APIENTRY *DrawArraysInstanced)(GLenum mode, GLint first, GLsizei count, GLsizei instances);
+    void (APIENTRY *ActiveTexture)(GLenum texture);
+    
+    bool load() {
+        TINYGUI_LOAD_GL(CreateShader) TINYGUI_LOAD_GL(ShaderSource) TINYGUI_LOAD_GL(CompileShader)
+        TINYGUI_LOAD_GL(GetShaderiv) TINYGUI_LOAD_GL(GetShaderInfoLog) TINYGUI_LOAD_GL(DeleteShader)
+        TINYGUI_LOAD_GL(CreateProgram) TINYGUI_LOAD_GL(AttachShader) TINYGUI_LOAD_GL(LinkProgram)
+        TINYGUI_LOAD_GL(GetProgramiv) TINYGUI_LOAD_GL(GetProgramInfoLog) TINYGUI_LOAD_GL(DeleteProgram)
+        TINYGUI_LOAD_GL(UseProgram) TINYGUI_LOAD_GL(GetUniformLocation) TINYGUI_LOAD_GL(UniformMatrix4fv)
+        TINYGUI_LOAD_GL(Uniform1i) TINYGUI_LOAD_GL(GenVertexArrays) TINYGUI_LOAD_GL(BindVertexArray)
+        TINYGUI_LOAD_GL(DeleteVertexArrays) TINYGUI_LOAD_GL(GenBuffers) TINYGUI_LOAD_GL(BindBuffer)
+        TINYGUI_LOAD_GL(BufferData) TINYGUI_LOAD_GL(DeleteBuffers) TINYGUI_LOAD_GL(EnableVertexAttribArray)
+        TINYGUI_LOAD_GL(VertexAttribPointer) TINYGUI_LOAD_GL(VertexAttribDivisor)
+        TINYGUI_LOAD_GL(DrawArraysInstanced) TINYGUI_LOAD_GL(ActiveTexture)
+        return true;
+    }
+};
+
+// One instance per quad: a parallelogram (origin plus two edge vectors), so
+// rects, text segments, images and thick lines all share the unit quad
+struct QuadInstance {
+    float originX, originY;
+    float axisXx, axisXy;  // v0 -> v1
+    float axisYx, axisYy;  // v0 -> v3
+    float u, v, du, dv;    // uv at v0 and extent to v2
+    unsigned int color;    // RGBA8, as in Vertex
+};
+
+inline QuadInstance quadInstance(const Vertex* v) {
+    QuadInstance q;
+    q.originX = v[0].posX(); q.originY = v[0].posY();
+    q.axisXx = v[1].posX() - q.originX; q.axisXy = v[1].posY() - q.originY;
+    q.axisYx = v[3].posX() - q.originX; q.axisYy = v[3].posY() - q.originY;
+    q.u = v[0].texU(); q.v = v[0].texV();
+    q.du = v[2].texU() - q.u; q.dv = v[2].texV() - q.v;
+    q.color = v[0].color;
+    return q;
+}
+
+struct GLCoreRenderer : GLRenderer {
+    GLCoreFunctions gl;
+    GLuint program;
+    GLuint vao, quadVbo, instanceVbo;
+    GLint projectionLoc;
+    std::vector<QuadInstance> instances; // reused every frame
+    
+    GLCoreRenderer() : program(0), vao(0), quadVbo(0), instanceVbo(0), projectionLoc(-1) {}
+    
+    GLuint compile(GLenum type, const char* src) {
+        GLuint shader = gl.CreateShader(type);
+        gl.ShaderSource(shader, 1, &src, NULL);
+        gl.CompileShader(shader);
+        GLint ok = 0;
+        gl.GetShaderiv(shader, TINYGUI_GL_COMPILE_STATUS, &ok);
+        if (!ok) {
+            char log[1024];
+            gl.GetShaderInfoLog(shader, sizeof(log), NULL, log);
+            printf("TinyGUI shader error: %s\n", log);
+            gl.DeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+    
+    bool init(GLFWwindow* w) {
+        if (!gl.load()) return false;
+        
+        static const char* vsSrc =
+            "#version 330 core\n"
+            "layout(location = 0) in vec2 aCorner;\n"
+            "layout(location = 1) in vec2 aOrigin;\n"
+            "layout(location = 2) in vec2 aAxisX;\n"
+            "layout(location = 3) in vec2 aAxisY;\n"
+            "layout(location = 4) in vec4 aUV;\n"
+            "layout(location = 5) in vec4 aColor;\n"
+            "uniform mat4 uProjection;\n"
+            "out vec2 vUV;\n"
+            "out vec4 vColor;\n"
+            "void main() {\n"
+            "    vec2 pos = aOrigin + aAxisX * aCorner.x + aAxisY * aCorner.y;\n"
+            "    vUV = aUV.xy + aUV.zw * aCorner;\n"
+            "    vColor = aColor;\n"
+            "    gl_Position = uProjection * vec4(pos, 0.0, 1.0);\n"
+            "}\n";
+        static const char* fsSrc =
+            "#version 330 core\n"
+            "in vec2 vUV;\n"
+            "in vec4 vColor;\n"
+            "uniform sampler2D uTexture;\n"
+            "out vec4 fragColor;\n"
+            "void main() {\n"
+            "    fragColor = texture(uTexture, vUV) * vColor;\n"
+            "}\n";
+        
+        GLuint vs = compile(TINYGUI_GL_VERTEX_SHADER, vsSrc);
+        GLuint fs = compile(TINYGUI_GL_FRAGMENT_SHADER, fsSrc);
+        if (!vs || !fs) return false;
+        program = gl.CreateProgram();
+        gl.AttachShader(program, vs);
+        gl.AttachShader(program, fs);
+        gl.LinkProgram(program);
+        gl.DeleteShader(vs);
+        gl.DeleteShader(fs);
+        GLint ok = 0;
+        gl.GetProgramiv(program, TINYGUI_GL_LINK_STATUS, &ok);
+        if (!ok) {
+            char log[1024];
+            gl.GetProgramInfoLog(program, sizeof(log), NULL, log);
+            printf("TinyGUI program link error: %s\n", log);
+            gl.DeleteProgram(program);
+            program = 0;
+            return false;
+        }
+        projectionLoc = gl.GetUniformLocation(program, "uProjection");
+        gl.UseProgram(program);
+        gl.Uniform1i(gl.GetUniformLocation(program, "uTexture"), 0);
+        
+        // Unit quad as a triangle strip; the instance buffer is re-specified per frame
+        static const float corners[8] = {0, 0, 1, 0, 0, 1, 1, 1};
+        gl.GenVertexArrays(1, &vao);
+        gl.BindVertexArray(vao);
+        gl.GenBuffers(1, &quadVbo);
+        gl.BindBuffer(TINYGUI_GL_ARRAY_BUFFER, quadVbo);
+        gl.BufferData(TINYGUI_GL_ARRAY_BUFFER, sizeof(corners), corners, TINYGUI_GL_STATIC_DRAW);
+        gl.EnableVertexAttribArray(0);
+        gl.VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (const void*)0);
+        gl.GenBuffers(1, &instanceVbo);
+        for (GLuint i = 1; i <= 5; ++i) {
+            gl.EnableVertexAttribArray(i);
+            gl.VertexAttribDivisor(i, 1);
+        }
+        return GLRenderer::init(w);
+    }
+    
+    void shutdown() override {
+        GLRenderer::shutdown();
+        if (!program) return;
+        gl.DeleteBuffers(1, &instanceVbo);
+        gl.DeleteBuffers(1, &quadVbo);
+        gl.DeleteVertexArrays(1, &vao);
+        gl.DeleteProgram(program);
+        program = 0;
+    }
+    
+    // Convert the frame's quads to instances
+    void buildInstances(const std::vector<DrawBatch>& batches, const Vertex* verts) {
+        instances.clear();
+        for (const DrawBatch& batch : batches) {
+            const Vertex* v = verts + batch.first;
+            for (int i = 0; i + 3 < batch.count; i += 4, v += 4) instances.push_back(quadInstance(v));
+        }
+    }
+    
+    // Upload one instance per quad, one instanced draw per batch
+    int submit(const std::vector<DrawBatch>& batches, const Vertex* base) override {
+        buildInstances(batches, base);
+        
+        const ClipRect& view = scissor.screen;
+        // Column-major ortho: top-left origin, Y down
+        const float projection[16] = {
+            2.0f / view.w, 0, 0, 0,
+            0, -2.0f / view.h, 0, 0,
+            0, 0, -1, 0,
+            -1 - 2.0f * view.x / view.w, 1 + 2.0f * view.y / view.h, 0, 1
+        };
+        gl.UseProgram(program);
+        gl.UniformMatrix4fv(projectionLoc, 1, GL_FALSE, projection);
+        gl.ActiveTexture(TINYGUI_GL_TEXTURE0);
+        gl.BindVertexArray(vao);
+        gl.BindBuffer(TINYGUI_GL_ARRAY_BUFFER, instanceVbo);
+        // Orphan and refill: the driver hands back fresh storage instead of syncing
+        gl.BufferData(TINYGUI_GL_ARRAY_BUFFER, (ptrdiff_t)(instances.size() * sizeof(QuadInstance)),
+                      instances.data(), TINYGUI_GL_STREAM_DRAW);
+        
+        int drawCalls = 0;
+        for (const ClipRect& pass : passes) {
+            int instance = 0;
+            for (const DrawBatch& batch : batches) {
+                int count = batch.count / 4;
+                ClipRect clip = batch.clip.intersect(pass);
+                if (count == 0 || clip.empty()) {
+                    instance += count;
+                    continue;
+                }
+                setClip(clip);
+                bindTexture(batch.texture);
+                // GL 3.3 has no base-instance draw, so point the instance attributes at this batch
+                const char* offset = (const char*)0 + instance * sizeof(QuadInstance);
+                const GLsizei stride = sizeof(QuadInstance);
+                gl.VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, offset + offsetof(QuadInstance, originX));
+                gl.VertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, offset + offsetof(QuadInstance, axisXx));
+                gl.VertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, offset + offsetof(QuadInstance, axisYx));
+                gl.VertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, stride, offset + offsetof(QuadInstance, u));
+                gl.VertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, offset + offsetof(QuadInstance, color));
+                gl.DrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+                instance += count;
+                drawCalls++;
+            }
+        }
+        gl.BindVertexArray(0);
+        gl.UseProgram(0);
+        setClip(scissor.screen);
+        return drawCalls;
+    }
+};
+
+// ==================== Software Rasterizer Backend ====================
+// Headless renderer for machines without a GPU. The batched quads are binned
+// into screen tiles and the tiles are rasterized in parallel into an RGBA8
+// framebuffer; each tile replays its quads in submission order.
+static constexpr int TINYGUI_TILE_SIZE = 64;
+
+// Small fixed pool of worker threads; the calling thread also takes jobs
+struct WorkerPool {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    // job and jobCount only change in run(), once every worker has reported
+    // back on the previous generation; workers read them without the lock
+    std::function<void(int)> job;
+    std::atomic<int> next;
+    int jobCount;
+    int finished;           // workers done with the current generation
+    unsigned generation;
+    bool quit;
+    
+    WorkerPool() : next(0), jobCount(0), finished(0), generation(0), quit(false) {}
+    ~WorkerPool() { stop(); }
+    
+    void start(int count) {
+        for (int i = 0; i < count; ++i) threads.emplace_back([this] { workerLoop(); });
+    }
+    
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+        wake.notify_all();
+        for (std::thread& t : threads) t.join();
+        threads.clear();
+        quit = false;
+    }
+    
+    void drain() {
+        for (int i = next++; i < jobCount; i = next++) job(i);
+    }
+    
+    void workerLoop() {
+        unsigned seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return quit || generation != seen; });
+                if (quit) return;
+                seen = generation;
+            }
+            drain();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished++;
+            }
+            done.notify_one();
+        }
+    }
+    
+    // Run fn(0..count-1) across the pool and wait for completion. Waiting for
+    // every worker, not just for the indices, keeps a worker that woke late
+    // from still running this job when the next run() replaces it.
+    void run(int count, const std::function<void(int)>& fn) {
+        if (threads.empty() || count <= 1) {
+            for (int i = 0; i < count; ++i) fn(i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = fn;
+            jobCount = count;
+            next = 0;
+            finished = 0;
+            generation++;
+        }
+        wake.notify_all();
+        drain();
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return finished == (int)threads.size(); });
+    }
+};
+
+struct SoftwareTexture {
+    int width, height;
+    std::vector<unsigned char> pixels; // RGBA8, rows top to bottom
+};
+
+// A quad after binning: parallelogram, color and covered pixel bounds
+struct SoftwarePrim {
+    QuadInstance quad;
+    const SoftwareTexture* texture;    // null = untextured
+    int x0, y0, x1, y1;                // pixel bounds already clipped, max exclusive
+    unsigned int rgba;                 // color packed as bytes R, G, B, A
+    bool axisAligned;
+};
+
+// Fill a span with one opaque color, four pixels per store where SSE2 exists
+inline void fillSpan(unsigned int* dst, int n, unsigned int rgba) {
+    int i = 0;
+#if TINYGUI_HAS_SSE2
+    __m128i v = _mm_set1_epi32((int)rgba);
+    for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i*)(dst + i), v);
+#endif
+    for (; i < n; ++i) dst[i] = rgba;
+}
+
+// dst = src * a + dst * (1 - a) per channel, a from src alpha (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA)
+inline unsigned int blendPixel(unsigned int dst, unsigned int src) {
+    unsigned int a = src >> 24, ia = 255 - a;
+    unsigned int out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        unsigned int s = (src >> shift) & 255, d = (dst >> shift) & 255;
+        unsigned int c = s * a + d * ia + 128;
+        out |= ((c + (c >> 8)) >> 8) << shift;
+    }
+    return out;
+}
+
+// Blend one constant color over a span
+inline void blendSpan(unsigned int* dst, int n, unsigned int rgba) {
+    int i = 0;
+#if TINYGUI_HAS_SSE2
+    unsigned int a = rgba >> 24;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i src = _mm_mullo_epi16(_mm_unpacklo_epi8(_mm_set1_epi32((int)rgba), zero), _mm_set1_epi16((short)a));
+    const __m128i ia = _mm_set1_epi16((short)(255 - a));
+    const __m128i half = _mm_set1_epi16(128);
+    for (; i + 4 <= n; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), ia), src), half);
+        __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), ia), src), half);
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_packus_epi16(lo, hi));
+    }
+#endif
+    for (; i < n; ++i) dst[i] = blendPixel(dst[i], rgba);
+}
+
+// Bilinear sample with clamp-to-edge, matching GL_LINEAR
+inline unsigned int sampleTexture(const SoftwareTexture& tex, float u, float v) {
+    float tx = u * tex.width - 0.5f, ty = v * tex.height - 0.5f;
+    int ix = (int)std::floor(tx), iy = (int)std::floor(ty);
+    int fx = (int)((tx - ix) * 256.0f + 0.5f), fy = (int)((ty - iy) * 256.0f + 0.5f);  // fx == 256 selects x1 alone
+    int x0 = std::max(0, std::min(ix, tex.width - 1)), x1 = std::max(0, std::min(ix + 1, tex.width - 1));
+    int y0 = std::max(0, std::min(iy, tex.height - 1)), y1 = std::max(0, std::min(iy + 1, tex.height - 1));
+    const unsigned char* p00 = &tex.pixels[(y0 * tex.width + x0) * 4];
+    const unsigned char* p10 = &tex.pixels[(y0 * tex.width + x1) * 4];
+    const unsigned char* p01 = &tex.pixels[(y1 * tex.width + x0) * 4];
+    const unsigned char* p11 = &tex.pixels[(y1 * tex.width + x1) * 4];
+    unsigned int out = 0;
+    for (int c = 0; c < 4; ++c) {
+        int top = p00[c] * (256 - fx) + p10[c] * fx;
+        int bottom = p01[c] * (256 - fx) + p11[c] * fx;
+        out |= (unsigned int)((top * (256 - fy) + bottom * fy + 32768) >> 16) << (c * 8);
+    }
+    return out;
+}
+
+// Per-channel product of two packed colors
+inline unsigned int modulate(unsigned int a, unsigned int b) {
+    unsigned int out = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        unsigned int c = ((a >> shift) & 255) * ((b >> shift) & 255) + 128;
+        out |= ((c + (c >> 8)) >> 8) << shift;
+    }
+    return out;
+}
+
+struct SoftwareRenderer : Renderer {
+    int width, height;
+    std::vector<unsigned int> framebuffer;   // RGBA8 rows top to bottom
+    std::vector<SoftwareTexture> textures;   // texture id N lives at index N - 1
+    std::vector<SoftwarePrim> prims;
+    std::vector<std::vector<int> > tileBins;  // prim indices per tile, in draw order
+    std::vector<unsigned char> tileDirty;     // tiles touched by this frame's damage
+    std::vector<int> dirtyTiles;
+    int tilesX, tilesY;
+    unsigned int clearColor;
+    ClipRect clip;                            // applies to prims added next, in pixels
+    float viewX, viewY;                       // logical position of pixel (0, 0); moved for layers
+    WorkerPool pool;
+    std::deque<FrameImage> readbacks;         // copies not yet taken
+    
+    SoftwareRenderer() : width(0), height(0), tilesX(0), tilesY(0), clearColor(0), viewX(0), viewY(0) {}
+    
+    void init(int w, int h) {
+        resize(w, h);
+        unsigned hw = std::thread::hardware_concurrency();
+        pool.start(hw > 1 ? (int)hw - 1 : 0);
+    }
+    
+    void resize(int w, int h) {
+        if (w == width && h == height) return;
+        framebuffer.assign((size_t)w * h, 0);
+        resizeTiles(w, h);
+    }
+    
+    void resizeTiles(int w, int h) {
+        width = w; height = h;
+        tilesX = (w + TINYGUI_TILE_SIZE - 1) / TINYGUI_TILE_SIZE;
+        tilesY = (h + TINYGUI_TILE_SIZE - 1) / TINYGUI_TILE_SIZE;
+        tileBins.assign((size_t)tilesX * tilesY, std::vector<int>());
+        tileDirty.assign((size_t)tilesX * tilesY, 1);
+    }
+    
+    void shutdown() override {
+        pool.stop();
+    }
+    
+    bool preservesContents() const override { return true; }
+    bool supportsLayers() const override { return true; }
+    
+    unsigned int uploadTexture(const unsigned char* rgba, int w, int h) override {
+        SoftwareTexture tex;
+        tex.width = w; tex.height = h;
+        if (rgba) tex.pixels.assign(rgba, rgba + (size_t)w * h * 4);
+        else tex.pixels.assign((size_t)w * h * 4, 0);
+        textures.push_back(tex);
+        return (unsigned int)textures.size();
+    }
+    
+    // Ids index the texture array, so the slot stays and only the pixels go
+    void releaseTexture(unsigned int texture) override {
+        if (texture && texture <= textures.size()) textures[texture - 1] = SoftwareTexture();
+    }
+    
+    void updateTexture(unsigned int texture, int x, int y, int w, int h, const unsigned char* rgba) override {
+        if (!texture || texture > textures.size()) return;
+        SoftwareTexture& tex = textures[texture - 1];
+        for (int row = 0; row < h; ++row)
+            memcpy(&tex.pixels[((size_t)(y + row) * tex.width + x) * 4], rgba + (size_t)row * w * 4, (size_t)w * 4);
+    }
+    
+    // Runs the tile pipeline on a region-sized buffer, then copies it into the layer texture
+    unsigned int renderLayer(unsigned int layer, const ClipRect& region, const FrameTarget& frame,
+                             const std::vector<DrawBatch>& batches, const Vertex* verts) override {
+        int w = std::max(1, (int)std::ceil(region.w)), h = std::max(1, (int)std::ceil(region.h));
+        if (!layer) layer = uploadTexture(nullptr, w, h);
+        
+        // Park the window's pixels; they must survive for partial redraws
+        int mainW = width, mainH = height;
+        std::vector<unsigned int> pixels((size_t)w * h);
+        framebuffer.swap(pixels);
+        resizeTiles(w, h);
+        viewX = region.x; viewY = region.y;
+        beginFrame(FrameTarget(w, h, w, h, frame.clearColor));
+        submit(batches, verts);
+        present();
+        memcpy(textures[layer - 1].pixels.data(), framebuffer.data(), (size_t)w * h * 4);
+        
+        viewX = viewY = 0;
+        framebuffer.swap(pixels);
+        resizeTiles(mainW, mainH);
+        return layer;
+    }
+    
+    void addPrim(QuadInstance q, unsigned int texture) {
+        q.originX -= viewX;
+        q.originY -= viewY;
+        SoftwarePrim p;
+        p.quad = q;
+        p.texture = (texture && texture <= textures.size()) ? &textures[texture - 1] : nullptr;
+        p.rgba = q.color;
+        if ((p.rgba >> 24) == 0 && !p.texture) return;
+        // Rects, and lines extruded from horizontal or vertical segments
+        p.axisAligned = (q.axisXy == 0.0f && q.axisYx == 0.0f) || (q.axisXx == 0.0f && q.axisYy == 0.0f);
+        
+        float xs[4] = {q.originX, q.originX + q.axisXx, q.originX + q.axisYx, q.originX + q.axisXx + q.axisYx};
+        float ys[4] = {q.originY, q.originY + q.axisXy, q.originY + q.axisYy, q.originY + q.axisXy + q.axisYy};
+        float bx0 = std::max(*std::min_element(xs, xs + 4), clip.x);
+        float by0 = std::max(*std::min_element(ys, ys + 4), clip.y);
+        float bx1 = std::min(*std::max_element(xs, xs + 4), clip.x + clip.w);
+        float by1 = std::min(*std::max_element(ys, ys + 4), clip.y + clip.h);
+        // Pixel centers inside [b0, b1): same coverage rule as GL
+        p.x0 = std::max(0, (int)std::ceil(bx0 - 0.5f));
+        // Rows follow GL's bottom-left origin, so ties go to the lower pixel
+        p.y0 = std::max(0, (int)std::floor(by0 - 0.5f) + 1);
+        p.x1 = std::min(width, (int)std::ceil(bx1 - 0.5f));
+        p.y1 = std::min(height, (int)std::floor(by1 - 0.5f) + 1);
+        if (p.x0 >= p.x1 || p.y0 >= p.y1) return;
+        
+        int index = (int)prims.size();
+        prims.push_back(p);
+        for (int ty = p.y0 / TINYGUI_TILE_SIZE; ty <= (p.y1 - 1) / TINYGUI_TILE_SIZE; ++ty)
+            for (int tx = p.x0 / TINYGUI_TILE_SIZE; tx <= (p.x1 - 1) / TINYGUI_TILE_SIZE; ++tx)
+                if (tileDirty[ty * tilesX + tx]) tileBins[ty * tilesX + tx].push_back(index);
+    }
+    
+    void drawPrim(const SoftwarePrim& p, int x0, int y0, int x1, int y1) {
+        const QuadInstance& q = p.quad;
+        if (p.axisAligned && !p.texture) {
+            bool opaque = (p.rgba >> 24) == 255;
+            for (int y = y0; y < y1; ++y) {
+                unsigned int* row = &framebuffer[(size_t)y * width + x0];
+                if (opaque) fillSpan(row, x1 - x0, p.rgba);
+                else blendSpan(row, x1 - x0, p.rgba);
+            }
+            return;
+        }
+        // Map each pixel center back to quad coordinates (s, t). Axis-aligned
+        // quads are fully covered by their pixel bounds; others test s and t.
+        float det = q.axisXx * q.axisYy - q.axisXy * q.axisYx;
+        if (det == 0.0f) return;
+        float inv = 1.0f / det;
+        for (int y = y0; y < y1; ++y) {
+            unsigned int* row = &framebuffer[(size_t)y * width];
+            float py = y + 0.5f - q.originY;
+            for (int x = x0; x < x1; ++x) {
+                float px = x + 0.5f - q.originX;
+                float s = (px * q.axisYy - py * q.axisYx) * inv;
+                float t = (py * q.axisXx - px * q.axisXy) * inv;
+                if (p.axisAligned) {
+                    s = std::max(0.0f, std::min(1.0f, s));
+                    t = std::max(0.0f, std::min(1.0f, t));
+                } else if (s < 0.0f || s >= 1.0f || t < 0.0f || t >= 1.0f) {
+                    continue;
+                }
+                unsigned int src = p.rgba;
+                if (p.texture) src = modulate(sampleTexture(*p.texture, q.u + s * q.du, q.v + t * q.dv), p.rgba);
+                row[x] = blendPixel(row[x], src);
+            }
+        }
+    }
+    
+    void rasterizeTile(int tile) {
+        int tx = tile % tilesX, ty = tile / tilesX;
+        int x0 = tx * TINYGUI_TILE_SIZE, y0 = ty * TINYGUI_TILE_SIZE;
+        int x1 = std::min(width, x0 + TINYGUI_TILE_SIZE), y1 = std::min(height, y0 + TINYGUI_TILE_SIZE);
+        for (int y = y0; y < y1; ++y) fillSpan(&framebuffer[(size_t)y * width + x0], x1 - x0, clearColor);
+        for (int index : tileBins[tile]) {
+            const SoftwarePrim& p = prims[index];
+            drawPrim(p, std::max(x0, p.x0), std::max(y0, p.y0), std::min(x1, p.x1), std::min(y1, p.y1));
+        }
+    }
+    
+    void beginFrame(const FrameTarget& target) override {
+        resize(target.framebufferW, target.framebufferH);
+        clearColor = target.clearColor.toRGBA8();
+        clip = ClipRect(0, 0, (float)width, (float)height);
+        prims.clear();
+        for (std::vector<int>& bin : tileBins) bin.clear();
+        
+        // Tile mask: only tiles under a damage rect are cleared and rasterized
+        std::fill(tileDirty.begin(), tileDirty.end(), target.damage ? 0 : 1);
+        if (target.damage) {
+            for (const ClipRect& rect : *target.damage) {
+                int x0 = std::max(0, (int)rect.x / TINYGUI_TILE_SIZE);
+                int y0 = std::max(0, (int)rect.y / TINYGUI_TILE_SIZE);
+                int x1 = std::min(tilesX - 1, ((int)std::ceil(rect.x + rect.w) - 1) / TINYGUI_TILE_SIZE);
+                int y1 = std::min(tilesY - 1, ((int)std::ceil(rect.y + rect.h) - 1) / TINYGUI_TILE_SIZE);
+                for (int ty = y0; ty <= y1; ++ty)
+                    for (int tx = x0; tx <= x1; ++tx) tileDirty[ty * tilesX + tx] = 1;
+            }
+        }
+        dirtyTiles.clear();
+        for (int i = 0; i < tilesX * tilesY; ++i) if (tileDirty[i]) dirtyTiles.push_back(i);
+    }
+    
+    void setClip(const ClipRect& rect) override {
+        clip = ClipRect(rect.x - viewX, rect.y - viewY, rect.w, rect.h);
+    }
+    
+    // Bin every quad, then rasterize all tiles; one "draw call" per batch
+    int submit(const std::vector<DrawBatch>& batches, const Vertex* verts) override {
+        for (const DrawBatch& batch : batches) {
+            setClip(batch.clip);
+            const Vertex* v = verts + batch.first;
+            for (int i = 0; i + 3 < batch.count; i += 4, v += 4) addPrim(quadInstance(v), batch.texture);
+        }
+        return (int)batches.size();
+    }
+    
+    // Tiles are cleared even when nothing was submitted
+    void present() override {
+        pool.run((int)dirtyTiles.size(), [this](int i) { rasterizeTile(dirtyTiles[i]); });
+    }
+    
+    // The framebuffer is already in memory, so a copy is done at once
+    void readback(unsigned long long frame) override {
+        FrameImage image;
+        image.width = width; image.height = height;
+        image.frame = frame;
+        const unsigned char* pixels = (const unsigned char*)framebuffer.data();
+        image.rgba.assign(pixels, pixels + framebuffer.size() * 4);
+        readbacks.push_back(std::move(image));
+    }
+    
+    bool takeReadback(FrameImage& out, bool) override {
+        if (readbacks.empty()) return false;
+        out = std::move(readbacks.front());
+        readbacks.pop_front();
+        return true;
+    }
+};
+
+// ==================== Render Thread ====================
+// With InitOptions::renderThread the GL backends run on a thread that owns the
+// context. Renderer calls made while building a frame are recorded into a
+// command list, and present() hands the list over, so the app builds frame N+1
+// while frame N is submitted and presented. Texture ids are handed out up front
+// and mapped to the backend's ids when the commands run.
+static constexpr int TINYGUI_MAX_QUEUED_FRAMES = 1;  // default finished frames waiting for the render thread
+
+struct RenderCommand {
+    enum Kind { UPLOAD, UPDATE, RELEASE, BEGIN_FRAME, SET_CLIP, SUBMIT, PRESENT, LAYER, INVALIDATE, CALL, READBACK };
+    Kind kind;
+    unsigned int id;              // texture or layer id from ThreadedRenderer
+    unsigned long long frame;     // READBACK frame number
+    int x, y, w, h;               // texture rect
+    ClipRect clip;                // SET_CLIP clip, LAYER region
+    FrameTarget target;           // damage is rebuilt from the list when it runs
+    bool hasPixels, hasDamage;
+    size_t pixels;                // offset into CommandList::pixels
+    size_t firstBatch, batchCount, firstVertex, firstDamage, damageCount;
+    
+    RenderCommand(Kind kind) : kind(kind), id(0), frame(0), x(0), y(0), w(0), h(0), hasPixels(false), hasDamage(false),
+                               pixels(0), firstBatch(0), batchCount(0), firstVertex(0), firstDamage(0), damageCount(0) {}
+};
+
+// Everything one frame asked of the renderer, with its data copied out
+struct CommandList {
+    std::vector<RenderCommand> commands;
+    std::vector<unsigned char> pixels;
+    std::vector<DrawBatch> batches;
+    std::vector<Vertex> vertices;
+    std::vector<ClipRect> damage;
+    std::vector<std::function<void()>> calls;
+    
+    void clear() {
+        commands.clear(); pixels.clear(); batches.clear();
+        vertices.clear(); damage.clear(); calls.clear();
+    }
+    
+    void addDraw(RenderCommand& cmd, const std::vector<DrawBatch>& b, const Vertex* v) {
+        cmd.firstBatch = batches.size();
+        cmd.batchCount = b.size();
+        cmd.firstVertex = vertices.size();
+        int count = 0;
+        for (const DrawBatch& batch : b) count = std::max(count, batch.first + batch.count);
+        batches.insert(batches.end(), b.begin(), b.end());
+        vertices.insert(vertices.end(), v, v + count);
+    }
+};
+
+struct ThreadedRenderer : Renderer {
+    Renderer* inner;
+    GLFWwindow* window;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<CommandList> lists;   // one recording, one running, the rest queued
+    std::deque<int> queued;
+    std::vector<int> freeLists;
+    int recording;
+    int maxQueued;
+    bool busy, stopping;
+    unsigned int nextId;                  // app side
+    std::vector<unsigned int> backendIds; // render thread side, indexed by our ids
+    std::vector<DrawBatch> scratchBatches;
+    // Results published by the render thread, a frame or more late
+    std::atomic<int> drawCalls, avoidedCalls;
+    std::atomic<bool> preserves, layers;
+    bool rowsBottomUp;
+    std::deque<FrameImage> readbacks;     // finished on the render thread, guarded by `mutex`
+    
+    ThreadedRenderer() : inner(nullptr), window(nullptr), recording(0), maxQueued(1), busy(false), stopping(false),
+                         nextId(0), drawCalls(0), avoidedCalls(0), preserves(false), layers(false), rowsBottomUp(false) {}
+    ~ThreadedRenderer() { stop(); }
+    
+    bool running() const { return thread.joinable(); }
+    
+    // Take over `backend` and the window's context, which must be current here
+    void start(Renderer* backend, GLFWwindow* win, int queueDepth) {
+        stop();
+        inner = backend;
+        window = win;
+        maxQueued = std::max(1, queueDepth);
+        lists.assign(maxQueued + 2, CommandList());
+        queued.clear();
+        freeLists.clear();
+        for (int i = 1; i < (int)lists.size(); ++i) freeLists.push_back(i);
+        recording = 0;
+        busy = stopping = false;
+        preserves = inner->preservesContents();
+        layers = inner->supportsLayers();
+        rowsBottomUp = inner->layerRowsBottomUp();
+        glfwMakeContextCurrent(NULL);
+        thread = std::thread([this] { run(); });
+    }
+    
+    // Run what is queued, then release the backend and the context
+    void stop() {
+        if (!running()) return;
+        flush();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+    
+    // Queue the recorded list, waiting while maxQueued lists are already waiting
+    void flush() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return (int)queued.size() < maxQueued; });
+            queued.push_back(recording);
+            recording = freeLists.back();
+            freeLists.pop_back();
+        }
+        changed.notify_all();
+    }
+    
+    // Block until every recorded command has run
+    void finish() {
+        if (!running()) return;
+        if (!lists[recording].commands.empty()) flush();
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return queued.empty() && !busy; });
+    }
+    
+    // Run `fn` on the render thread, with the context current, in command order
+    void call(std::function<void()> fn) {
+        CommandList& list = lists[recording];
+        RenderCommand cmd(RenderCommand::CALL);
+        cmd.id = (unsigned int)list.calls.size();
+        list.calls.push_back(std::move(fn));
+        list.commands.push_back(cmd);
+    }
+    
+    void record(RenderCommand cmd, const unsigned char* rgba = nullptr, size_t bytes = 0) {
+        CommandList& list = lists[recording];
+        if (rgba) {
+            cmd.hasPixels = true;
+            cmd.pixels = list.pixels.size();
+            list.pixels.insert(list.pixels.end(), rgba, rgba + bytes);
+        }
+        list.commands.push_back(cmd);
+    }
+    
+    // ---- Renderer, called by the app thread ----
+    unsigned int uploadTexture(const unsigned char* rgba, int width, int height) override {
+        RenderCommand cmd(RenderCommand::UPLOAD);
+        cmd.id = ++nextId;
+        cmd.w = width; cmd.h = height;
+        record(cmd, rgba, (size_t)width * height * 4);
+        return cmd.id;
+    }
+    
+    void updateTexture(unsigned int texture, int x, int y, int w, int h, const unsigned char* rgba) override {
+        RenderCommand cmd(RenderCommand::UPDATE);
+        cmd.id = texture;
+        cmd.x = x; cmd.y = y; cmd.w = w; cmd.h = h;
+        record(cmd, rgba, (size_t)w * h * 4);
+    }
+    
+    void releaseTexture(unsigned int texture) override {
+        RenderCommand cmd(RenderCommand::RELEASE);
+        cmd.id = texture;
+        record(cmd);
+    }
+    
+    void beginFrame(const FrameTarget& target) override {
+        CommandList& list = lists[recording];
+        RenderCommand cmd(RenderCommand::BEGIN_FRAME);
+        cmd.target = target;
+        cmd.target.damage = nullptr;
+        if (target.damage) {
+            cmd.hasDamage = true;
+            cmd.firstDamage = list.damage.size();
+            cmd.damageCount = target.damage->size();
+            list.damage.insert(list.damage.end(), target.damage->begin(), target.damage->end());
+        }
+        record(cmd);
+    }
+    
+    void setClip(const ClipRect& clip) override {
+        RenderCommand cmd(RenderCommand::SET_CLIP);
+        cmd.clip = clip;
+        record(cmd);
+    }
+    
+    // Returns the draw calls of the last frame the render thread finished
+    int submit(const std::vector<DrawBatch>& batches, const Vertex* vertices) override {
+        RenderCommand cmd(RenderCommand::SUBMIT);
+        lists[recording].addDraw(cmd, batches, vertices);
+        record(cmd);
+        return drawCalls;
+    }
+    
+    void present() override {
+        record(RenderCommand(RenderCommand::PRESENT));
+        flush();
+    }
+    
+    void shutdown() override { stop(); }
+    bool preservesContents() const override { return preserves; }
+    int takeAvoidedStateCalls() override { return avoidedCalls.exchange(0); }
+    void invalidateState() override { record(RenderCommand(RenderCommand::INVALIDATE)); }
+    
+    void readback(unsigned long long frame) override {
+        RenderCommand cmd(RenderCommand::READBACK);
+        cmd.frame = frame;
+        record(cmd);
+    }
+    
+    // Copies finish on the render thread after later frames; waiting runs
+    // everything recorded so far and then blocks for the copies
+    bool takeReadback(FrameImage& out, bool wait) override {
+        if (wait) {
+            call([this] { collectReadbacks(true); });
+            finish();
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (readbacks.empty()) return false;
+        out = std::move(readbacks.front());
+        readbacks.pop_front();
+        return true;
+    }
+    
+    unsigned int renderLayer(unsigned int layer, const ClipRect& region, const FrameTarget& frame,
+                             const std::vector<DrawBatch>& batches, const Vertex* verts) override {
+        if (!layers) return 0;
+        RenderCommand cmd(RenderCommand::LAYER);
+        cmd.id = layer ? layer : ++nextId;
+        cmd.clip = region;
+        cmd.target = frame;
+        cmd.target.damage = nullptr;
+        lists[recording].addDraw(cmd, batches, verts);
+        record(cmd);
+        return cmd.id;
+    }
+    bool supportsLayers() const override { return layers; }
+    bool layerRowsBottomUp() const override { return rowsBottomUp; }
+    
+    // ---- Render thread ----
+    unsigned int& backendId(unsigned int id) {
+        if (id >= backendIds.size()) backendIds.resize(id + 1, 0);
+        return backendIds[id];
+    }
+    
+    // Batches name our texture ids; swap in the backend's before drawing
+    const std::vector<DrawBatch>& mapBatches(const CommandList& list, const RenderCommand& cmd) {
+        scratchBatches.assign(list.batches.begin() + cmd.firstBatch, list.batches.begin() + cmd.firstBatch + cmd.batchCount);
+        for (DrawBatch& batch : scratchBatches) batch.texture = batch.texture ? backendId(batch.texture) : 0;
+        return scratchBatches;
+    }
+    
+    void execute(CommandList& list) {
+        std::vector<ClipRect> damage;
+        for (const RenderCommand& cmd : list.commands) {
+            const unsigned char* pixels = cmd.hasPixels ? &list.pixels[cmd.pixels] : nullptr;
+            switch (cmd.kind) {
+            case RenderCommand::UPLOAD:
+                backendId(cmd.id) = inner->uploadTexture(pixels, cmd.w, cmd.h);
+                break;
+            case RenderCommand::UPDATE:
+                if (backendId(cmd.id)) inner->updateTexture(backendId(cmd.id), cmd.x, cmd.y, cmd.w, cmd.h, pixels);
+                break;
+            case RenderCommand::RELEASE:
+                if (backendId(cmd.id)) inner->releaseTexture(backendId(cmd.id));
+                backendId(cmd.id) = 0;
+                break;
+            case RenderCommand::BEGIN_FRAME: {
+                FrameTarget target = cmd.target;
+                if (cmd.hasDamage) {
+                    damage.assign(list.damage.begin() + cmd.firstDamage, list.damage.begin() + cmd.firstDamage + cmd.damageCount);
+                    target.damage = &damage;
+                }
+                inner->beginFrame(target);
+                break;
+            }
+            case RenderCommand::SET_CLIP:
+                inner->setClip(cmd.clip);
+                break;
+            case RenderCommand::SUBMIT:
+                drawCalls = inner->submit(mapBatches(list, cmd), &list.vertices[cmd.firstVertex]);
+                break;
+            case RenderCommand::PRESENT:
+                inner->present();
+                break;
+            case RenderCommand::LAYER: {
+                unsigned int& id = backendId(cmd.id);
+                id = inner->renderLayer(id, cmd.clip, cmd.target, mapBatches(list, cmd), list.vertices.data() + cmd.firstVertex);
+                break;
+            }
+            case RenderCommand::INVALIDATE:
+                inner->invalidateState();
+                break;
+            case RenderCommand::CALL:
+                list.calls[cmd.id]();
+                break;
+            case RenderCommand::READBACK:
+                inner->readback(cmd.frame);
+                break;
+            }
+        }
+        collectReadbacks(false);
+        avoidedCalls += inner->takeAvoidedStateCalls();
+        preserves = inner->preservesContents();
+        layers = inner->supportsLayers();
+    }
+    
+    void collectReadbacks(bool wait) {
+        FrameImage image;
+        while (inner->takeReadback(image, wait)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            readbacks.push_back(std::move(image));
+        }
+    }
+    
+    void run() {
+        glfwMakeContextCurrent(window);
+        for (;;) {
+            int index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return stopping || !queued.empty(); });
+                if (queued.empty()) break;
+                index = queued.front();
+                queued.pop_front();
+                busy = true;
+            }
+            execute(lists[index]);
+            lists[index].clear();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                freeLists.push_back(index);
+                busy = false;
+            }
+            changed.notify_all();
+        }
+        inner->shutdown();
+        glfwMakeContextCurrent(NULL);
+    }
+};
+
+// ==================== Headless GL Contexts ====================
+// InitOptions::headless. A hidden GLFW window still needs a display server;
+// EGL surfaceless and OSMesa contexts need none (Mesa's llvmpipe runs both on
+// a bare server). Windowless contexts have no default framebuffer to show, so
+// frames stay in the renderer's offscreen buffer; read them with
+// requestFrameReadback().
+enum HeadlessMode {
+    HEADLESS_OFF,     // visible window
+    HEADLESS_HIDDEN,  // invisible GLFW window
+    HEADLESS_EGL,     // EGL surfaceless context; build with TINYGUI_USE_EGL and link libEGL
+    HEADLESS_OSMESA   // OSMesa context; build with TINYGUI_USE_OSMESA and link libOSMesa
+};
+
+#ifdef TINYGUI_USE_EGL
+inline void* loadEGLProc(const char* name) { return (void*)eglGetProcAddress(name); }
+#endif
+#ifdef TINYGUI_USE_OSMESA
+inline void* loadOSMesaProc(const char* name) { return (void*)OSMesaGetProcAddress(name); }
+#endif
+
+// A GL context with no window, made current on its own
+struct OffscreenGL {
+    HeadlessMode mode;   // HEADLESS_EGL or HEADLESS_OSMESA once created
+#ifdef TINYGUI_USE_EGL
+    EGLDisplay eglDisplay;
+    EGLContext eglContext;
+#endif
+#ifdef TINYGUI_USE_OSMESA
+    OSMesaContext osmesaContext;
+    std::vector<unsigned char> osmesaBuffer;  // default framebuffer; rendering goes to an FBO
+    int osmesaW, osmesaH;
+#endif
+    
+    OffscreenGL() : mode(HEADLESS_OFF) {
+#ifdef TINYGUI_USE_EGL
+        eglDisplay = EGL_NO_DISPLAY;
+        eglContext = EGL_NO_CONTEXT;
+#endif
+#ifdef TINYGUI_USE_OSMESA
+        osmesaContext = nullptr;
+        osmesaW = osmesaH = 0;
+#endif
+    }
+    
+    bool active() const { return mode == HEADLESS_EGL || mode == HEADLESS_OSMESA; }
+    
+    // Create a context (3.3 core when `core`) sharing objects with `share`, and make it current
+    bool create(HeadlessMode headless, int w, int h, bool core, const OffscreenGL* share) {
+        destroy();
+#ifdef TINYGUI_USE_EGL
+        if (headless == HEADLESS_EGL) {
+            PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+                (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+            eglDisplay = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+                                            : EGL_NO_DISPLAY;
+            if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, NULL, NULL) || !eglBindAPI(EGL_OPENGL_API)) {
+                printf("TinyGUI: EGL surfaceless display unavailable\n");
+                return false;
+            }
+            // Surfaceless displays may list no configs; contexts work without one
+            EGLConfig config = EGL_NO_CONFIG_KHR;
+            EGLint configs = 0;
+            const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+            if (!eglChooseConfig(eglDisplay, configAttribs, &config, 1, &configs) || configs == 0) config = EGL_NO_CONFIG_KHR;
+            const EGLint coreAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+                                          EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+            EGLContext shareContext = share && share->mode == HEADLESS_EGL ? share->eglContext : EGL_NO_CONTEXT;
+            eglContext = eglCreateContext(eglDisplay, config, shareContext, core ? coreAttribs : NULL);
+            if (eglContext == EGL_NO_CONTEXT) return false;
+            mode = HEADLESS_EGL;
+            return makeCurrent();
+        }
+#endif
+#ifdef TINYGUI_USE_OSMESA
+        if (headless == HEADLESS_OSMESA) {
+            const int coreAttribs[] = {OSMESA_FORMAT, OSMESA_RGBA, OSMESA_DEPTH_BITS, 0, OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+                                       OSMESA_CONTEXT_MAJOR_VERSION, 3, OSMESA_CONTEXT_MINOR_VERSION, 3, 0};
+            const int compatAttribs[] = {OSMESA_FORMAT, OSMESA_RGBA, OSMESA_DEPTH_BITS, 0, OSMESA_PROFILE, OSMESA_COMPAT_PROFILE, 0};
+            OSMesaContext shareContext = share && share->mode == HEADLESS_OSMESA ? share->osmesaContext : NULL;
+            osmesaContext = OSMesaCreateContextAttribs(core ? coreAttribs : compatAttribs, shareContext);
+            if (!osmesaContext) return false;
+            osmesaW = w; osmesaH = h;
+            osmesaBuffer.assign((size_t)w * h * 4, 0);
+            mode = HEADLESS_OSMESA;
+            return makeCurrent();
+        }
+#endif
+        (void)headless; (void)w; (void)h; (void)core; (void)share;
+        printf("TinyGUI: headless mode %d not compiled in\n", (int)headless);
+        return false;
+    }
+    
+    // Bind on this thread
+    bool makeCurrent() {
+#ifdef TINYGUI_USE_EGL
+        if (mode == HEADLESS_EGL) return eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext) == EGL_TRUE;
+#endif
+#ifdef TINYGUI_USE_OSMESA
+        if (mode == HEADLESS_OSMESA) return OSMesaMakeCurrent(osmesaContext, osmesaBuffer.data(), GL_UNSIGNED_BYTE, osmesaW, osmesaH) == GL_TRUE;
+#endif
+        return false;
+    }
+    
+    // Entry point loader for this kind of context
+    GLProcLoader loader() const {
+#ifdef TINYGUI_USE_EGL
+        if (mode == HEADLESS_EGL) return loadEGLProc;
+#endif
+#ifdef TINYGUI_USE_OSMESA
+        if (mode == HEADLESS_OSMESA) return loadOSMesaProc;
+#endif
+        return nullptr;
+    }
+    
+    // The EGL display stays initialized; other contexts may still use it
+    void destroy() {
+#ifdef TINYGUI_USE_EGL
+        if (mode == HEADLESS_EGL) {
+            eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(eglDisplay, eglContext);
+            eglContext = EGL_NO_CONTEXT;
+        }
+#endif
+#ifdef TINYGUI_USE_OSMESA
+        if (mode == HEADLESS_OSMESA) {
+            OSMesaDestroyContext(osmesaContext);
+            osmesaContext = nullptr;
+            osmesaBuffer.clear();
+        }
+#endif
+        mode = HEADLESS_OFF;
+    }
+};
+
+// ==================== Screenshots ====================
+// Captured frames are written as PNG on a thread of their own, so capturing
+// does not change the frame times it is meant to observe. The encoder needs no
+// library: rows get PNG's usual per-row filter choice, then LZ77 with deflate's
+// fixed Huffman codes, which suits flat UI colors well.
+static constexpr int TINYGUI_SCREENSHOT_QUEUE = 8;  // frames waiting for the PNG thread before capture blocks
+
+// CRC-32 as used by PNG chunks; pass the previous result to continue a checksum
+inline unsigned int crc32(const unsigned char* data, size_t n, unsigned int crc = 0) {
+    static const struct Table {
+        unsigned int v[256];
+        Table() {
+            for (unsigned int i = 0; i < 256; ++i) {
+                unsigned int c = i;
+                for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                v[i] = c;
+            }
+        }
+    } table;
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = table.v[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline unsigned int adler32(const unsigned char* data, size_t n) {
+    unsigned int a = 1, b = 0;
+    while (n > 0) {
+        size_t chunk = std::min(n, (size_t)5552);  // largest run before the sums can overflow
+        n -= chunk;
+        while (chunk--) { a += *data++; b += a; }
+        a %= 65521; b %= 65521;
+    }
+    return (b << 16) | a;
+}
+
+// Deflate packs bits from the least significant end; Huffman codes go most significant bit first
+struct DeflateBits {
+    std::vector<unsigned char>& out;
+    unsigned int bits;
+    int count;
+    
+    explicit DeflateBits(std::vector<unsigned char>& out) : out(out), bits(0), count(0) {}
+    
+    void put(unsigned int value, int n) {
+        bits |= value << count;
+        count += n;
+        while (count >= 8) { out.push_back((unsigned char)bits); bits >>= 8; count -= 8; }
+    }
+    
+    void putCode(unsigned int code, int n) {
+        unsigned int reversed = 0;
+        for (int i = 0; i < n; ++i) reversed |= ((code >> i) & 1) << (n - 1 - i);
+        put(reversed, n);
+    }
+    
+    // Fixed literal/length code of `symbol` (0-287)
+    void putSymbol(int symbol) {
+        if (symbol < 144) putCode(0x30 + symbol, 8);
+        else if (symbol < 256) putCode(0x190 + symbol - 144, 9);
+        else if (symbol < 280) putCode(symbol - 256, 7);
+        else putCode(0xC0 + symbol - 280, 8);
+    }
+    
+    void flush() {
+        if (count > 0) out.push_back((unsigned char)bits);
+        bits = 0; count = 0;
+    }
+};
+
+// zlib stream of one fixed-Huffman deflate block; matches come from 3-byte hash chains
+inline void zlibCompress(const unsigned char* data, size_t n, std::vector<unsigned char>& out) {
+    static const int lengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59,
+                                       67, 83, 99, 115, 131, 163, 195, 227, 258};
+    static const int lengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+    static const int distBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769,
+                                     1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+    static const int distExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+    const int window = 32768, hashBits = 15, maxChain = 16, maxMatch = 258;
+    
+    out.push_back(0x78); out.push_back(0x01);  // deflate, 32K window, fastest
+    DeflateBits bits(out);
+    bits.put(1, 1);  // final block
+    bits.put(1, 2);  // fixed Huffman codes
+    
+    std::vector<int> head((size_t)1 << hashBits, -1), prev(window, -1);
+    auto hash = [&](size_t p) {
+        unsigned int key = (unsigned int)data[p] << 16 | (unsigned int)data[p + 1] << 8 | data[p + 2];
+        return (key * 2654435761u) >> (32 - hashBits);
+    };
+    auto insert = [&](size_t p) {
+        if (p + 2 >= n) return;
+        unsigned int h = hash(p);
+        prev[p & (window - 1)] = head[h];
+        head[h] = (int)p;
+    };
+    
+    size_t i = 0;
+    while (i < n) {
+        int bestLen = 0, bestDist = 0;
+        if (i + 2 < n) {
+            int maxLen = (int)std::min((size_t)maxMatch, n - i);
+            int candidate = head[hash(i)];
+            // Older entries of `prev` are overwritten after a window, so stop before that
+            for (int chain = 0; candidate >= 0 && chain < maxChain && i - candidate < (size_t)window; ++chain) {
+                const unsigned char* a = data + i;
+                const unsigned char* b = data + candidate;
+                if (bestLen < maxLen && b[bestLen] != a[bestLen]) {
+                    candidate = prev[candidate & (window - 1)];
+                    continue;  // cannot beat the best so far
+                }
+                int len = 0;
+                while (len < maxLen && a[len] == b[len]) ++len;
+                if (len > bestLen) {
+                    bestLen = len;
+                    bestDist = (int)(i - candidate);
+                    if (len == maxLen) break;
+                }
+                candidate = prev[candidate & (window - 1)];
+            }
+        }
+        if (bestLen >= 3) {
+            int code = 0;
+            while (code < 28 && lengthBase[code + 1] <= bestLen) ++code;
+            bits.putSymbol(257 + code);
+            bits.put(bestLen - lengthBase[code], lengthExtra[code]);
+            int dist = 0;
+            while (dist < 29 && distBase[dist + 1] <= bestDist) ++dist;
+            bits.putCode(dist, 5);
+            bits.put(bestDist - distBase[dist], distExtra[dist]);
+            for (int k = 0; k < bestLen; ++k) insert(i + k);
+            i += bestLen;
+        } else {
+            bits.putSymbol(data[i]);
+            insert(i);
+            ++i;
+        }
+    }
+    bits.putSymbol(256);  // end of block
+    bits.flush();
+    unsigned int check = adler32(data, n);
+    for (int shift = 24; shift >= 0; shift -= 8) out.push_back((unsigned char)(check >> shift));
+}
+
+// PNG file of RGBA8 pixels, top row first
+inline std::vector<unsigned char> encodePNG(const unsigned char* rgba, int width, int height) {
+    // Each row keeps whichever filter leaves the smallest residuals. One pass
+    // scores all five, a second writes the winner.
+    size_t stride = (size_t)width * 4;
+    std::vector<unsigned char> filtered((stride + 1) * height);
+    std::vector<unsigned char> blankRow(stride, 0);
+    auto paeth = [](int a, int b, int c) {
+        int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+    };
+    auto cost = [](int residual) { return std::abs((int)(signed char)residual); };
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* row = rgba + stride * y;
+        const unsigned char* up = y > 0 ? row - stride : blankRow.data();
+        long sums[5] = {0, 0, 0, 0, 0};
+        for (size_t x = 0; x < stride; ++x) {
+            int v = row[x], a = x >= 4 ? row[x - 4] : 0, b = up[x], c = x >= 4 ? up[x - 4] : 0;
+            sums[0] += cost(v);
+            sums[1] += cost(v - a);
+            sums[2] += cost(v - b);
+            sums[3] += cost(v - (a + b) / 2);
+            sums[4] += cost(v - paeth(a, b, c));
+        }
+        int filter = (int)(std::min_element(sums, sums + 5) - sums);
+        unsigned char* dst = &filtered[(stride + 1) * y];
+        dst[0] = (unsigned char)filter;
+        for (size_t x = 0; x < stride; ++x) {
+            int a = x >= 4 ? row[x - 4] : 0, b = up[x], c = x >= 4 ? up[x - 4] : 0;
+            const int predict[5] = {0, a, b, (a + b) / 2, filter == 4 ? paeth(a, b, c) : 0};
+            dst[1 + x] = (unsigned char)(row[x] - predict[filter]);
+        }
+    }
+    std::vector<unsigned char> idat;
+    zlibCompress(filtered.data(), filtered.size(), idat);
+    
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    auto put32 = [&](unsigned int v) {
+        for (int shift = 24; shift >= 0; shift -= 8) png.push_back((unsigned char)(v >> shift));
+    };
+    auto chunk = [&](const char* type, const unsigned char* data, size_t size) {
+        put32((unsigned int)size);
+        size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        if (size) png.insert(png.end(), data, data + size);
+        put32(crc32(&png[start], size + 4));
+    };
+    const unsigned char header[13] = {(unsigned char)(width >> 24), (unsigned char)(width >> 16), (unsigned char)(width >> 8), (unsigned char)width,
+                                      (unsigned char)(height >> 24), (unsigned char)(height >> 16), (unsigned char)(height >> 8), (unsigned char)height,
+                                      8, 6, 0, 0, 0};  // 8-bit RGBA, deflate, adaptive filters, no interlace
+    chunk("IHDR", header, sizeof(header));
+    chunk("IDAT", idat.data(), idat.size());
+    chunk("IEND", nullptr, 0);
+    return png;
+}
+
+// Encodes and writes queued frames in order, started on first use
+struct ScreenshotWriter {
+    struct Job {
+        FrameImage image;
+        std::string path;
+    };
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Job> jobs;
+    bool busy, stopping;
+    
+    ScreenshotWriter() : busy(false), stopping(false) {}
+    ~ScreenshotWriter() { stop(); }
+    
+    // Blocks only while TINYGUI_SCREENSHOT_QUEUE frames are already waiting
+    void write(FrameImage&& image, const std::string& path) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!thread.joinable()) {
+            stopping = false;
+            thread = std::thread([this] { run(); });
+        }
+        changed.wait(lock, [&] { return (int)jobs.size() < TINYGUI_SCREENSHOT_QUEUE; });
+        Job job;
+        job.image = std::move(image);
+        job.path = path;
+        jobs.push_back(std::move(job));
+        changed.notify_all();
+    }
+    
+    // Wait until every queued file is written
+    void finish() {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] { return jobs.empty() && !busy; });
+    }
+    
+    void stop() {
+        if (!thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        thread.join();
+    }
+    
+    void run() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [&] { return stopping || !jobs.empty(); });
+                if (jobs.empty()) break;
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                busy = true;
+            }
+            changed.notify_all();
+            const FrameImage& image = job.image;
+            std::vector<unsigned char> png = encodePNG(image.rgba.data(), image.width, image.height);
+            FILE* file = fopen(job.path.c_str(), "wb");
+            if (!file || fwrite(png.data(), 1, png.size(), file) != png.size()) {
+                printf("TinyGUI: failed to write screenshot %s\n", job.path.c_str());
+            }
+            if (file) fclose(file);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy = false;
+            }
+            changed.notify_all();
+        }
+    }
+};
+
+// ==================== Glyph Atlas ====================
+// stb_easy_font draws every lit segment as its own quad. At integer scales the
+// glyphs are rasterized once per scale into a texture instead, and text becomes
+// one textured quad per character covering the same pixels the segments would.
+static constexpr int TINYGUI_GLYPH_FIRST = 32;   // printable ASCII, the range stb_easy_font covers
+static constexpr int TINYGUI_GLYPH_COUNT = 95;
+static constexpr int TINYGUI_MAX_ATLAS_SCALE = 8; // texels per font unit; larger text keeps the segment quads
+
+struct GlyphAtlas {
+    struct Glyph {
+        int x0, y0, x1, y1;       // bounds in font units from the pen position; empty for blanks
+        float u0, v0, u1, v1;
+    };
+    
+    int scale;              // texels per font unit
+    unsigned int texture;   // 0 until built, or when the upload failed
+    Glyph glyphs[TINYGUI_GLYPH_COUNT];
+    
+    GlyphAtlas() : scale(0), texture(0) {}
+    
+    // Rasterize the segments of every glyph into a grid of cells and upload it
+    bool build(Renderer* renderer, int texelScale) {
+        scale = texelScale;
+        float quads[256 * 16];  // 64 bytes per segment; glyphs use a few dozen at most
+        std::vector<ClipRect> segs[TINYGUI_GLYPH_COUNT];
+        int cellW = 1, cellH = 1;
+        for (int i = 0; i < TINYGUI_GLYPH_COUNT; ++i) {
+            char text[2] = {(char)(TINYGUI_GLYPH_FIRST + i), 0};
+            int n = stb_easy_font_print(0, 0, text, NULL, quads, sizeof(quads));
+            Glyph& g = glyphs[i];
+            g.x0 = g.y0 = 1 << 20; g.x1 = g.y1 = -(1 << 20);
+            for (int q = 0; q < n; ++q) {
+                const float* v = quads + q * 16;   // corners 0 and 2 span the segment
+                ClipRect seg(v[0], v[1], v[8] - v[0], v[9] - v[1]);
+                segs[i].push_back(seg);
+                g.x0 = std::min(g.x0, (int)seg.x); g.x1 = std::max(g.x1, (int)(seg.x + seg.w));
+                g.y0 = std::min(g.y0, (int)seg.y); g.y1 = std::max(g.y1, (int)(seg.y + seg.h));
+            }
+            if (n == 0) g.x0 = g.y0 = g.x1 = g.y1 = 0;
+            cellW = std::max(cellW, g.x1 - g.x0);
+            cellH = std::max(cellH, g.y1 - g.y0);
+        }
+        
+        // One transparent texel between cells keeps neighbours out of edge samples
+        const int cols = 16, rows = (TINYGUI_GLYPH_COUNT + cols - 1) / cols;
+        int pitchX = cellW * scale + 1, pitchY = cellH * scale + 1;
+        // Power-of-two sides keep every cell edge exact in the fixed-point vertex uvs
+        int w = 1, h = 1;
+        while (w < cols * pitchX) w *= 2;
+        while (h < rows * pitchY) h *= 2;
+        std::vector<unsigned char> pixels((size_t)w * h * 4, 0);
+        for (int i = 0; i < TINYGUI_GLYPH_COUNT; ++i) {
+            Glyph& g = glyphs[i];
+            int ox = (i % cols) * pitchX, oy = (i / cols) * pitchY;
+            for (const ClipRect& seg : segs[i]) {
+                int x0 = ox + ((int)seg.x - g.x0) * scale, x1 = x0 + (int)seg.w * scale;
+                int y0 = oy + ((int)seg.y - g.y0) * scale, y1 = y0 + (int)seg.h * scale;
+                for (int y = y0; y < y1; ++y)
+                    std::memset(&pixels[((size_t)y * w + x0) * 4], 255, (size_t)(x1 - x0) * 4);
+            }
+            g.u0 = (float)ox / w;
+            g.v0 = (float)oy / h;
+            g.u1 = (float)(ox + (g.x1 - g.x0) * scale) / w;
+            g.v1 = (float)(oy + (g.y1 - g.y0) * scale) / h;
+        }
+        texture = renderer->uploadTexture(pixels.data(), w, h);
+        return texture != 0;
+    }
+};
+
+// ==================== TrueType Fonts ====================
+// A font set with setFont() replaces stb_easy_font for label() and text
+// measurement. Outlines and metrics come from stb_truetype.h; glyphs are
+// rasterized on first use into one shared atlas.
+static constexpr float TINYGUI_FONT_PIXEL_HEIGHT = 12.0f;      // ascent to descent at scale 1, like stb_easy_font lines
+static constexpr size_t TINYGUI_FONT_ATLAS_BUDGET = 1 << 20;  // default bytes of glyph atlas texture
+
+// Next code point of UTF-8 text; malformed bytes decode as themselves
+inline int decodeUTF8(const char*& text) {
+    const unsigned char* p = (const unsigned char*)text;
+    int cp = *p++, extra = cp >= 0xF0 ? 3 : cp >= 0xE0 ? 2 : cp >= 0xC0 ? 1 : 0;
+    if (extra) {
+        int value = cp & (0x3F >> extra);
+        int i = 0;
+        for (; i < extra && (p[i] & 0xC0) == 0x80; ++i) value = (value << 6) | (p[i] & 0x3F);
+        if (i == extra) { cp = value; p += extra; }
+    }
+    text = (const char*)p;
+    return cp;
+}
+
+#if TINYGUI_HAS_TRUETYPE
+struct FontFace {
+    std::vector<unsigned char> data;   // stbtt_fontinfo points into this buffer
+    stbtt_fontinfo info;
+    int ascent, descent, lineGap;   // font units, y up
+    
+    FontFace() : ascent(0), descent(0), lineGap(0) {}
+    
+    bool load(const unsigned char* bytes, size_t size) {
+        data.assign(bytes, bytes + size);
+        if (size < 12) return false;
+        int offset = stbtt_GetFontOffsetForIndex(data.data(), 0);   // first face of a collection
+        if (offset < 0 || !stbtt_InitFont(&info, data.data(), offset)) return false;
+        stbtt_GetFontVMetrics(&info, &ascent, &descent, &lineGap);
+        return ascent > descent;
+    }
+    
+    int glyphIndex(int codepoint) const { return stbtt_FindGlyphIndex(&info, codepoint); }
+    
+    float advance(int glyph) const {
+        int adv, lsb;
+        stbtt_GetGlyphHMetrics(&info, glyph, &adv, &lsb);
+        return (float)adv;
+    }
+    
+    // Anti-aliased coverage at `scale` pixels per unit. left/top place the
+    // bitmap relative to the pen on the baseline, y pointing down.
+    bool rasterize(int glyph, float scale, std::vector<unsigned char>& alpha, int& w, int& h, int& left, int& top) const {
+        int x0, y0, x1, y1;
+        stbtt_GetGlyphBitmapBox(&info, glyph, scale, scale, &x0, &y0, &x1, &y1);
+        w = x1 - x0; h = y1 - y0; left = x0; top = y0;
+        if (w <= 0 || h <= 0) { w = h = 0; return true; }
+        alpha.assign((size_t)w * h, 0);
+        stbtt_MakeGlyphBitmap(&info, alpha.data(), w, h, w, scale, scale, glyph);
+        return true;
+    }
+};
+#else
+// Built without stb_truetype.h: no face loads, so nothing else is ever asked
+struct FontFace {
+    int ascent, descent, lineGap;
+    
+    FontFace() : ascent(0), descent(0), lineGap(0) {}
+    
+    bool load(const unsigned char*, size_t) {
+        printf("TinyGUI: TrueType fonts need stb_truetype.h next to tinygui.h\n");
+        return false;
+    }
+    int glyphIndex(int) const { return 0; }
+    float advance(int) const { return 0.0f; }
+    bool rasterize(int, float, std::vector<unsigned char>&, int& w, int& h, int& left, int& top) const {
+        w = h = left = top = 0;
+        return false;
+    }
+};
+#endif
+
+struct Font {
+    int id;          // distinguishes this font's glyphs in the atlas
+    FontFace face;
+    float advances[128];   // ASCII advances in font units; most text never leaves this table
+    
+    // Pixels per font unit at a label scale
+    float unitScale(float scale) const {
+        return TINYGUI_FONT_PIXEL_HEIGHT * scale / (face.ascent - face.descent);
+    }
+    
+    // Baseline-to-baseline distance in font units, from the hhea metrics
+    float lineUnits() const {
+        return (float)(face.ascent - face.descent + face.lineGap);
+    }
+    
+    float lineHeight(float scale) const {
+        return lineUnits() * unitScale(scale);
+    }
+    
+    float advanceUnits(int codepoint) const {
+        return codepoint >= 0 && codepoint < 128 ? advances[codepoint] : face.advance(face.glyphIndex(codepoint));
+    }
+    
+    float advance(int codepoint, float scale) const {
+        return advanceUnits(codepoint) * unitScale(scale);
+    }
+};
+
+// Bottom-left skyline packing: the top edge of the used area is a list of
+// horizontal segments and each rect goes where it ends up lowest
+struct SkylinePacker {
+    struct Node { int x, y, w; };
+    int width, height;
+    std::vector<Node> nodes;
+    
+    SkylinePacker() : width(0), height(0) {}
+    
+    void reset(int w, int h) {
+        width = w; height = h;
+        nodes.assign(1, Node{0, 0, w});
+    }
+    
+    bool pack(int w, int h, int& outX, int& outY) {
+        int best = -1, bestY = height, bestW = width + 1;
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].x + w > width) break;
+            int y = 0;
+            for (size_t j = i, remaining = w; remaining > 0 && j < nodes.size(); ++j) {
+                y = std::max(y, nodes[j].y);
+                remaining -= std::min<size_t>(remaining, nodes[j].w);
+            }
+            if (y + h > height) continue;
+            if (y < bestY || (y == bestY && nodes[i].w < bestW)) { best = (int)i; bestY = y; bestW = nodes[i].w; }
+        }
+        if (best < 0) return false;
+        outX = nodes[best].x; outY = bestY;
+        
+        // The new segment shadows whatever it spans
+        nodes.insert(nodes.begin() + best, Node{outX, bestY + h, w});
+        for (size_t i = best + 1; i < nodes.size(); ) {
+            int shadow = nodes[i - 1].x + nodes[i - 1].w - nodes[i].x;
+            if (shadow <= 0) break;
+            nodes[i].x += shadow; nodes[i].w -= shadow;
+            if (nodes[i].w <= 0) nodes.erase(nodes.begin() + i); else break;
+        }
+        for (size_t i = 0; i + 1 < nodes.size(); ) {
+            if (nodes[i].y == nodes[i + 1].y) { nodes[i].w += nodes[i + 1].w; nodes.erase(nodes.begin() + i + 1); }
+            else ++i;
+        }
+        return true;
+    }
+};
+
+// Rasterized glyphs by font, size and glyph, least recently used first out.
+// Glyphs drawn in the current frame are never evicted, so quads recorded
+// earlier in the frame keep pointing at the right texels.
+struct FontAtlas {
+    struct Slot { int x, y, w, h; };
+    struct Entry {
+        unsigned long long key;
+        Slot slot;               // 1 texel of padding right and below is part of the slot
+        int width, height;       // bitmap size; 0 for blanks
+        int left, top;           // bitmap offset from the pen on the baseline, pixels
+        unsigned long long lastFrame;
+    };
+    
+    unsigned int texture;
+    int size;              // texture is size x size
+    size_t budget;
+    SkylinePacker packer;
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<unsigned long long, std::list<Entry>::iterator> index;
+    std::vector<Slot> freeSlots;   // left behind by evicted glyphs
+    unsigned long long frame;
+    
+    FontAtlas() : texture(0), size(0), budget(TINYGUI_FONT_ATLAS_BUDGET), frame(0) {}
+    
+    static unsigned long long keyOf(int font, int glyph, int sizeQ) {
+        return ((unsigned long long)font << 48) | ((unsigned long long)sizeQ << 24) | (unsigned int)glyph;
+    }
+    
+    Entry* find(unsigned long long key) {
+        auto it = index.find(key);
+        if (it == index.end()) return nullptr;
+        entries.splice(entries.begin(), entries, it->second);
+        it->second->lastFrame = frame;
+        return &*it->second;
+    }
+    
+    // Smallest free slot that fits, removed from the free list
+    bool takeFreeSlot(int w, int h, Slot& out) {
+        int best = -1;
+        for (size_t i = 0; i < freeSlots.size(); ++i) {
+            const Slot& s = freeSlots[i];
+            if (s.w >= w && s.h >= h && (best < 0 || s.w * s.h < freeSlots[best].w * freeSlots[best].h)) best = (int)i;
+        }
+        if (best < 0) return false;
+        out = freeSlots[best];
+        freeSlots.erase(freeSlots.begin() + best);
+        return true;
+    }
+    
+    // Room for a w*h bitmap plus padding, evicting unused glyphs if needed
+    bool allocate(int w, int h, Slot& out) {
+        w += 1; h += 1;
+        if (takeFreeSlot(w, h, out)) return true;
+        if (packer.pack(w, h, out.x, out.y)) { out.w = w; out.h = h; return true; }
+        while (!entries.empty() && entries.back().lastFrame != frame) {
+            const Entry& victim = entries.back();
+            if (victim.slot.w > 0) freeSlots.push_back(victim.slot);
+            index.erase(victim.key);
+            entries.pop_back();
+            if (takeFreeSlot(w, h, out)) return true;
+        }
+        // Everything left is in use this frame; once nothing is, start the atlas over
+        if (entries.empty()) {
+            freeSlots.clear();
+            packer.reset(size, size);
+            if (packer.pack(w, h, out.x, out.y)) { out.w = w; out.h = h; return true; }
+        }
+        return false;
+    }
+};
+
+struct Context {
+    GLFWwindow* window;
+    int displayW, displayH;   // window size in logical units, sampled in beginFrame
+    int framebufferW, framebufferH;
+    float mouseX, mouseY;
+    bool mouseDown;
+    bool mousePressed;
+    float wheelX, wheelY;     // scroll since the last frame, from onScroll()
+    
+    // Active input field or text area (at most one of them)
+    InputState* activeInput;
+    TextAreaState* activeTextArea;
+    
+    // Layout state
+    float layoutX, layoutY;  // Current layout position
+    float layoutSpacing;     // Space between widgets
+    bool layoutVertical;     // Layout direction
+    
+    // Menu system state
+    bool menuBarVisible;
+    int activeMenu;          // -1 = none, 0+ = menu index
+    int hoveredMenu;         // -1 = none, 0+ = menu index
+    float menuBarHeight;
+    int pendingMenuResult;   // Store menu result for automatic handling
+    float menuPositions[10]; // x of each menu title, up to 10 menus
+    
+    // Image system
+    std::map<std::string, ImageData> imageCache;
+    
+    // Modal dialog system
+    ModalState modal;
+    
+    // Geometry recorded for the current frame
+    DrawList drawList;
+    std::vector<ClipRect> clipStack; // nested clip rects, each already intersected with its parent
+    FrameStats stats;
+    
+    // Frame skipping: hash of the last presented draw list and its target
+    bool skipIdenticalFrames;
+    bool lastFrameValid;
+    unsigned long long lastFrameHash;
+    
+    // Partial redraw: regions that changed since the last presented frame
+    bool partialRedraw;
+    DamageTracker damage;
+    
+    // Lines: keep fractional widths and fade partly covered edge pixels
+    bool antialiasLines;
+    
+    // Cached regions: layers by id, the one being recorded, and layers re-rendered this frame
+    std::map<std::string, CachedRegion> cachedRegions;
+    CachedRegion* openRegion;
+    size_t regionFirstVertex, regionFirstBatch;
+    std::vector<DrawBatch> regionBatches;
+    std::vector<ClipRect> changedLayers;
+    
+    // Tessellated label geometry reused across frames
+    LabelCache labelCache;
+    TextMetricsCache textMetrics;   // text sizes for layout
+    std::map<int, GlyphAtlas> glyphAtlases;   // by texels per font unit
+    
+    // TrueType: loaded fonts by name, the active one (null = stb_easy_font) and their glyphs
+    std::map<std::string, Font> fonts;
+    Font* font;
+    int fontCount;
+    FontAtlas fontAtlas;
+    
+    // Renderer selected at init(); points at one of the backends below
+    RenderBackend backend;
+    Renderer* renderer;
+    GLRenderer glFixed;
+    GLCoreRenderer core;
+    SoftwareRenderer software;
+    NullRenderer nullRenderer;
+    ThreadedRenderer threaded;  // wraps the GL backend when InitOptions::renderThread is set
+    OffscreenGL offscreen;      // GL context of EGL and OSMesa headless modes, which have no window
+    
+    // Frame readback: endFrame() calls so far, and whether the next one copies its frame out
+    unsigned long long frameCount;
+    bool readbackRequested;
+    bool captureFrames;                 // read back every frame
+    std::string capturePattern;         // captured frames' PNG paths, see formatCapturePath(); "" = keep them
+    std::map<unsigned long long, std::string> screenshotPaths;  // saveScreenshot() requests by frame
+    std::deque<FrameImage> readbacks;   // finished copies for takeFrameReadback()
+    ScreenshotWriter screenshots;
+    
+    // Idle scheduling for waitEvents()
+    double redrawTime;                  // earliest deadline requested while building the last frame
+    int pendingFrames;                  // frames to draw before sleeping again
+    std::atomic<bool> redrawRequested;  // set by requestRedraw() from any thread
+};
+
+// ==================== Contexts ====================
+// All widget, input and renderer state lives in a Context. Every function
+// works on the calling thread's current context, the way GL calls work on the
+// current GL context. A thread that never made one current uses the
+// process-wide default context, so single-window apps never need to see one.
+inline Context*& currentContextSlot() {
+    static thread_local Context* current = nullptr;
+    return current;
+}
+
+inline Context& defaultContext() {
+    static Context context;
+    return context;
+}
+
+inline Context& getCurrentContext() {
+    Context* current = currentContextSlot();
+    return current ? *current : defaultContext();
+}
+
+// Make `context` current on this thread (null = the default context) and bind
+// its GL context here, unless a render thread owns that
+inline void makeContextCurrent(Context* context) {
+    currentContextSlot() = context;
+    Context& ctx = getCurrentContext();
+    if (ctx.threaded.running()) return;
+    if (ctx.offscreen.active()) ctx.offscreen.makeCurrent();
+    else glfwMakeContextCurrent(ctx.window);
+}
+
+// Switch the current context for one scope without touching GL, e.g. to route
+// a GLFW callback to the window it came from
+struct ContextScope {
+    Context* previous;
+    
+    explicit ContextScope(Context* context) : previous(currentContextSlot()) { currentContextSlot() = context; }
+    ~ContextScope() { currentContextSlot() = previous; }
+};
+
+// A blank context; make it current, then call init() to open its window
+inline Context* createContext() {
+    return new Context();
+}
+
+// Context that init() attached to `window`
+inline Context* getWindowContext(GLFWwindow* window) {
+    return window ? (Context*)glfwGetWindowUserPointer(window) : nullptr;
+}
+
+// Close the context's window and free its renderer and state
+inline void destroyContext(Context* context) {
+    if (!context || context == &defaultContext()) return;
+    if (context->threaded.running()) {
+        context->threaded.stop();
+    } else if (context->renderer) {
+        if (context->window) glfwMakeContextCurrent(context->window);
+        if (context->offscreen.active()) context->offscreen.makeCurrent();
+        context->renderer->shutdown();
+    }
+    context->offscreen.destroy();
+    if (context->window) {
+        glfwMakeContextCurrent(NULL);
+        glfwDestroyWindow(context->window);
+    }
+    if (currentContextSlot() == context) currentContextSlot() = nullptr;
+    delete context;
+}
+
+// Seconds since an arbitrary epoch; works without GLFW for headless backends
+inline double getTime() {
+    Context& ctx = getCurrentContext();
+    if (ctx.window) return glfwGetTime();
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+inline bool isKeyDown(int key) {
+    Context& ctx = getCurrentContext();
+    return ctx.window && glfwGetKey(ctx.window, key) == GLFW_PRESS;
+}
+
+// ============== Helpers for text editing ==============
+inline int textLen(InputState* input) {
+    if (!input) return 0;
+    return input->length();
+}
+
+inline int clampIndex(int i, InputState* input) {
+    int len = textLen(input);
+    return std::max(0, std::min(i, len));
+}
+
+inline bool hasSelection(InputState* input) {
+    if (!input) return false;
+    return input->caret != input->selAnchor;
+}
+
+inline void resetBlink(InputState* input) {
+    if (!input) return;
+    input->blinkStart = getTime();
+}
+
+inline void setCaret(InputState* input, int pos, bool keepSelection) {
+    if (!input) return;
+    pos = clampIndex(pos, input);
+    input->caret = pos;
+    if (!keepSelection) input->selAnchor = pos;
+    resetBlink(input);
+}
+
+// Advance of byte `i` of `text`, as drawn by label()
+inline float charWidthAt(const char* text, int i, float scale) {
+    Context& ctx = getCurrentContext();
+    unsigned char c = text[i];
+    if (ctx.font) {
+        // The lead byte of a UTF-8 sequence carries the whole advance
+        const char* p = text + i;
+        return (c & 0xC0) == 0x80 ? 0.0f : ctx.font->advance(decodeUTF8(p), scale);
+    }
+    if (c >= 32 && c < 128) {
+        // Advance width (bottom 4 bits) plus spacing from stb_easy_font's character info
+        return ((stb_easy_font_charinfo[c - 32].advance & 15) + stb_easy_font_spacing_val) * scale;
+    }
+    return 0.0f; // Invalid character
+}
+
+// Compute per-character widths and cumulative positions
+// Returns length actually processed.
+inline int computeCharWidths(const char* text, float scale,
+                            float* charWidths, float* cumWidths, int maxChars,
+                            float* outTotalWidth) {
+    int len = (int)std::strlen(text);
+    if (len > maxChars) len = maxChars;
+
+    float totalWidth = 0.0f;
+    for (int i = 0; i < len; ++i) {
+        charWidths[i] = charWidthAt(text, i, scale);
+        cumWidths[i] = totalWidth;
+        totalWidth += charWidths[i];
+    }
+    
+    if (outTotalWidth) *outTotalWidth = totalWidth;
+    return len;
+}
+
+// Measure `n` bytes of `text` (stored from byte `pos` of the input) into charWidths
+inline void measureInputBytes(InputState* input, int pos, const char* text, int n) {
+    for (int i = 0; i < n; ++i)
+        input->setCharWidth(input->physical(pos + i), charWidthAt(text, i, input->measuredScale));
+}
+
+// Measure the whole text again when it was never measured or the scale or
+// font changed. Edits keep the widths current themselves, so otherwise this
+// costs nothing.
+inline void syncInputWidths(InputState* input, float scale) {
+    Context& ctx = getCurrentContext();
+    int font = ctx.font ? ctx.font->id : 0;
+    if (input->charWidths.empty() || input->measuredScale != scale || input->measuredFont != font) {
+        const char* text = input->c_str();
+        int len = textLen(input);
+        input->measuredScale = scale;
+        input->measuredFont = font;
+        input->charWidths.assign(input->physical(len), 0.0f);  // the gap is at the end: the whole buffer
+        for (int i = 0; i < len; ++i) input->charWidths[i] = charWidthAt(text, i, scale);
+        input->rebuildWidthTree();
+    }
+}
+
+// Insert NUL-terminated `text` at `pos`. Only the new bytes are measured.
+inline void insertInputText(InputState* input, int pos, const char* text) {
+    int n = (int)std::strlen(text);
+    if (!input || n == 0) return;
+    pos = clampIndex(pos, input);
+    input->insertBytes(pos, text, n);
+    if (!input->charWidths.empty()) measureInputBytes(input, pos, text, n);
+}
+
+inline void eraseInputText(InputState* input, int a, int b) {
+    a = clampIndex(a, input);
+    b = clampIndex(b, input);
+    if (a < b) input->eraseBytes(a, b);
+}
+
+inline void deleteSelectionRange(InputState* input) {
+    if (!input || !hasSelection(input)) return;
+    int a = std::min(input->selAnchor, input->caret);
+    int b = std::max(input->selAnchor, input->caret);
+    eraseInputText(input, a, b);
+    input->caret = input->selAnchor = a;
+    resetBlink(input);
+}
+
+// ==================== Initialization ====================
+// Options for init(); the defaults match the original fixed-function setup
+struct InitOptions {
+    RenderBackend backend;
+    bool skipIdenticalFrames;  // don't resubmit or swap when the draw list is unchanged
+    bool partialRedraw;        // redraw only changed regions when the backend keeps the last frame
+    size_t labelCacheBudget;   // bytes of label geometry kept across frames; 0 disables the cache
+    size_t fontAtlasBudget;    // bytes of glyph atlas texture shared by TrueType fonts
+    bool antialiasLines;       // analytic edge coverage for lines and outlines
+    bool renderThread;         // GL backends: submit and present on a thread that owns the context
+    int readbackDepth;         // GL backends: pixel buffers in the frame readback ring
+    int maxQueuedFrames;       // finished frames that may wait for the render thread before endFrame() blocks
+    Context* shareWith;        // share GL textures with this context's window (same backend)
+    HeadlessMode headless;     // GL backends: hidden window or windowless context instead of a visible window
+    
+    InitOptions(RenderBackend backend = BACKEND_GL_FIXED)
+        : backend(backend), skipIdenticalFrames(true), partialRedraw(true), labelCacheBudget(TINYGUI_LABEL_CACHE_BUDGET),
+          fontAtlasBudget(TINYGUI_FONT_ATLAS_BUDGET), antialiasLines(false), renderThread(false),
+          readbackDepth(TINYGUI_READBACK_DEPTH), maxQueuedFrames(TINYGUI_MAX_QUEUED_FRAMES), shareWith(nullptr), headless(HEADLESS_OFF) {}
+};
+
+inline bool init(int w, int h, const char* title, const InitOptions& options = InitOptions()) {
+    Context& ctx = getCurrentContext();
+    ctx.window = nullptr;
+    ctx.backend = BACKEND_GL_FIXED;
+    ctx.renderer = nullptr;
+    GLFWwindow* share = options.shareWith ? options.shareWith->window : NULL;
+    bool hidden = options.headless == HEADLESS_HIDDEN;
+    if (options.backend == BACKEND_SOFTWARE || options.backend == BACKEND_NULL) {
+        // Headless: no GLFW, no GL; software frames land in ctx.software.framebuffer
+        ctx.backend = options.backend;
+        if (options.backend == BACKEND_SOFTWARE) {
+            ctx.software.init(w, h);
+            ctx.renderer = &ctx.software;
+        } else {
+            ctx.renderer = &ctx.nullRenderer;
+        }
+        ctx.displayW = ctx.framebufferW = w;
+        ctx.displayH = ctx.framebufferH = h;
+    } else if (options.headless == HEADLESS_EGL || options.headless == HEADLESS_OSMESA) {
+        // Windowless GL: no GLFW; the frame size is fixed at w x h
+        const OffscreenGL* shareGL = options.shareWith ? &options.shareWith->offscreen : nullptr;
+        if (options.backend == BACKEND_GL_CORE && ctx.offscreen.create(options.headless, w, h, true, shareGL)) {
+            glProcLoader() = ctx.offscreen.loader();
+            if (ctx.core.init(nullptr)) {
+                ctx.backend = BACKEND_GL_CORE;
+                ctx.renderer = &ctx.core;
+            } else {
+                printf("TinyGUI: OpenGL 3.3 core unavailable, using fixed-function renderer\n");
+            }
+        }
+        if (!ctx.renderer) {
+            if (!ctx.offscreen.create(options.headless, w, h, false, shareGL)) return false;
+            glProcLoader() = ctx.offscreen.loader();
+            ctx.glFixed.init(nullptr);
+            ctx.renderer = &ctx.glFixed;
+        }
+        glProcLoader() = nullptr;
+        ctx.displayW = ctx.framebufferW = w;
+        ctx.displayH = ctx.framebufferH = h;
+    } else if (!glfwInit()) {
+        return false;
+    }
+    
+    if (options.backend == BACKEND_GL_CORE && !ctx.renderer) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+        if (hidden) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        ctx.window = glfwCreateWindow(w, h, title, NULL, share);
+        if (ctx.window) {
+            glfwMakeContextCurrent(ctx.window);
+            if (ctx.core.init(ctx.window)) {
+                ctx.backend = BACKEND_GL_CORE;
+                ctx.renderer = &ctx.core;
+            } else {
+                // A core context cannot run the fixed-function path; start over
+                printf("TinyGUI: OpenGL 3.3 core unavailable, using fixed-function renderer\n");
+                glfwMakeContextCurrent(NULL);
+                glfwDestroyWindow(ctx.window);
+                ctx.window = nullptr;
+            }
+        }
+        glfwDefaultWindowHints();
+    }
+    if (!ctx.renderer) {
+        if (hidden) glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        ctx.window = glfwCreateWindow(w, h, title, NULL, share);
+        glfwDefaultWindowHints();
+        if (!ctx.window) return false;
+        glfwMakeContextCurrent(ctx.window);
+        ctx.glFixed.init(ctx.window);
+        ctx.renderer = &ctx.glFixed;
+    }
+    ctx.glFixed.readbackDepth = ctx.core.readbackDepth = std::max(1, options.readbackDepth);
+    if (options.renderThread && ctx.window) {
+        ctx.threaded.start(ctx.renderer, ctx.window, options.maxQueuedFrames);
+        ctx.renderer = &ctx.threaded;
+    }
+    
+    if (ctx.window) glfwSetWindowUserPointer(ctx.window, &ctx);
+    
+    // Set minimum window size to 800x600
+    if (ctx.window) glfwSetWindowSizeLimits(ctx.window, 800, 600, GLFW_DONT_CARE, GLFW_DONT_CARE);
+    // Uncovered or damaged window contents must be redrawn even if the frame is unchanged
+    if (ctx.window) glfwSetWindowRefreshCallback(ctx.window, [](GLFWwindow* window) {
+        if (Context* owner = getWindowContext(window))
+            owner->lastFrameValid = owner->damage.valid = false;
+    });
+
+    ctx.mouseX = ctx.mouseY = 0;
     ctx.mouseDown = ctx.mousePressed = false;
+    ctx.wheelX = ctx.wheelY = 0.0f;
     ctx.activeInput = nullptr;
+    ctx.activeTextArea = nullptr;
     
     // Initialize layout
     ctx.layoutX = ctx.layoutY = 0;
@@ -249,47 +3960,388 @@ inline bool init(int w, int h, const char* title) {
     ctx.hoveredMenu = -1;
     ctx.menuBarHeight = 25.0f;
     ctx.pendingMenuResult = -1;
+    
+    ctx.skipIdenticalFrames = options.skipIdenticalFrames;
+    ctx.lastFrameValid = false;
+    ctx.partialRedraw = options.partialRedraw;
+    ctx.damage.valid = false;
+    ctx.antialiasLines = options.antialiasLines;
+    ctx.openRegion = nullptr;
+    ctx.labelCache.budget = options.labelCacheBudget;
+    ctx.labelCache.trim();
+    ctx.font = nullptr;
+    ctx.fontCount = 0;
+    ctx.fontAtlas.budget = options.fontAtlasBudget;
+    
+    ctx.redrawTime = HUGE_VAL;
+    ctx.pendingFrames = 1;
+    ctx.redrawRequested = false;
+    ctx.frameCount = 0;
+    ctx.readbackRequested = false;
+    ctx.captureFrames = false;
+    ctx.capturePattern.clear();
+    ctx.screenshotPaths.clear();
+    ctx.readbacks.clear();
+    
+    // With shared GL objects the texture ids of the other window's images and
+    // glyph atlases work here as they are, so copy what it has loaded so far.
+    // The copies are independent: later loads in either window are not seen by
+    // the other, and fonts and their atlas are per window. Render threads hand
+    // out their own ids, so nothing is copied with those.
+    Context* other = options.shareWith;
+    bool shared = (share && ctx.window) || (other && ctx.offscreen.active() && other->offscreen.mode == ctx.offscreen.mode);
+    if (shared && other->backend == ctx.backend &&
+        !other->threaded.running() && !ctx.threaded.running()) {
+        ctx.imageCache = other->imageCache;
+        ctx.glyphAtlases = other->glyphAtlases;
+    }
 
     return true;
 }
 
-inline bool windowShouldClose() { return glfwWindowShouldClose(ctx.window); }
+inline bool windowShouldClose() {
+    Context& ctx = getCurrentContext();
+    return ctx.window && glfwWindowShouldClose(ctx.window);
+}
 
 // ==================== Event Handling ====================
+// Headless backends have no window to poll; tests drive the mouse from here
+inline void setMouseState(float x, float y, bool down) {
+    Context& ctx = getCurrentContext();
+    ctx.mousePressed = down && !ctx.mouseDown;
+    ctx.mouseX = x;
+    ctx.mouseY = y;
+    ctx.mouseDown = down;
+}
+
+inline void sampleMouse() {
+    Context& ctx = getCurrentContext();
+    double x, y;
+    glfwGetCursorPos(ctx.window, &x, &y);
+    ctx.mouseX = (float)x; // Window coords: origin top-left, Y down (matches our ortho)
+    ctx.mouseY = (float)y;
+
+    bool down = glfwGetMouseButton(ctx.window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+    ctx.mousePressed = down && !ctx.mouseDown;
+    ctx.mouseDown = down;
+}
+
 inline void pollEvents() {
+    Context& ctx = getCurrentContext();
+    if (!ctx.window) return;
     ctx.mousePressed = false;
     glfwPollEvents();
+    sampleMouse();
+}
+
+// Ask for a frame no later than `time` (see getTime()). Widgets call this while
+// building a frame, e.g. for the next caret blink; apps use it for animations.
+inline void requestRedrawAt(double time) {
+    Context& ctx = getCurrentContext();
+    ctx.redrawTime = std::min(ctx.redrawTime, time);
+}
+
+// Keep drawing without sleeping, for the frames of a running animation
+inline void requestAnimationFrame() {
+    requestRedrawAt(0.0);
+}
+
+// Wake waitEvents() of `context` (null = the current one) and draw one more
+// frame. Safe to call from any thread; a worker thread should pass the
+// window's context, since the worker's own current context is the default one.
+inline void requestRedraw(Context* context = nullptr) {
+    Context& ctx = context ? *context : getCurrentContext();
+    ctx.redrawRequested = true;
+    if (ctx.window) glfwPostEmptyEvent();
+}
+
+// Event-driven alternative to pollEvents(): sleeps until input arrives, a
+// requestRedrawAt() deadline passes or requestRedraw() is called. An idle
+// window then costs no CPU between caret blinks.
+inline void waitEvents() {
+    Context& ctx = getCurrentContext();
+    if (!ctx.window) return;
+    ctx.mousePressed = false;
+    
+    // A frame that handled input may have changed state drawn earlier in that
+    // same frame, so draw one more before sleeping
+    if (ctx.pendingFrames > 0 || ctx.redrawRequested.exchange(false)) {
+        if (ctx.pendingFrames > 0) ctx.pendingFrames--;
+        glfwPollEvents();
+    } else {
+        double now = getTime();
+        if (ctx.redrawTime == HUGE_VAL) glfwWaitEvents();
+        else if (ctx.redrawTime > now) glfwWaitEventsTimeout(ctx.redrawTime - now);
+        else glfwPollEvents();
+        // Woken before the deadline: input or another thread
+        if (getTime() < ctx.redrawTime) {
+            ctx.pendingFrames = 1;
+            ctx.redrawRequested = false;
+        }
+    }
+    sampleMouse();
+}
+
+// ==================== Frame Rendering ====================
+inline void beginFrame() {
+    Context& ctx = getCurrentContext();
+    // Sample sizes once per frame; widgets read them from the context
+    if (ctx.window) {
+        glfwGetFramebufferSize(ctx.window, &ctx.framebufferW, &ctx.framebufferH);
+        glfwGetWindowSize(ctx.window, &ctx.displayW, &ctx.displayH);
+    }
+
+    // Start recording; GL work happens in submitDrawList() from endFrame()
+    ctx.redrawTime = HUGE_VAL;
+    ctx.clipStack.clear();
+    ctx.openRegion = nullptr;
+    ctx.changedLayers.clear();
+    ++ctx.fontAtlas.frame;
+    ctx.drawList.clear(ClipRect(0, 0, (float)ctx.displayW, (float)ctx.displayH));
+}
+
+// Hand the frame's sorted draw list to the renderer
+inline void submitDrawList() {
+    Context& ctx = getCurrentContext();
+    DrawList& list = ctx.drawList;
+    ctx.stats = FrameStats();
+    ctx.stats.textMeasureHits = ctx.textMetrics.frameHits;
+    ctx.stats.textMeasureMisses = ctx.textMetrics.frameMisses;
+    ctx.textMetrics.frameHits = ctx.textMetrics.frameMisses = 0;
+    ctx.stats.batches = (int)list.batches.size();
+    ctx.stats.vertices = (int)list.vertices.size();
+    
+    // The back buffer may be stale, but the screen still shows this exact frame
+    if (ctx.skipIdenticalFrames) {
+        const int sizes[4] = {ctx.displayW, ctx.displayH, ctx.framebufferW, ctx.framebufferH};
+        unsigned long long hash = hashWords(sizes, sizeof(sizes), list.hash());
+        ctx.stats.skipped = ctx.lastFrameValid && hash == ctx.lastFrameHash && ctx.changedLayers.empty();
+        ctx.lastFrameHash = hash;
+        ctx.lastFrameValid = true;
+        if (ctx.stats.skipped) return;
+    }
+    
+    FrameTarget target(ctx.displayW, ctx.displayH, ctx.framebufferW, ctx.framebufferH, THEME_BG);
+    if (ctx.partialRedraw && ctx.renderer->preservesContents()) {
+        ctx.damage.update(list, ctx.displayW, ctx.displayH, ctx.framebufferW, ctx.framebufferH, ctx.changedLayers);
+        if (ctx.damage.rects.empty()) {
+            // Only off-screen or fully clipped geometry changed
+            ctx.stats.skipped = true;
+            return;
+        }
+        target.damage = &ctx.damage.rects;
+        ctx.stats.damageRects = (int)ctx.damage.rects.size();
+        for (const ClipRect& rect : ctx.damage.rects) ctx.stats.damageArea += rect.w * rect.h;
+    } else {
+        ctx.damage.valid = false;
+        ctx.stats.damageRects = 1;
+        ctx.stats.damageArea = (float)ctx.displayW * ctx.displayH;
+    }
+    
+    bool sorted = !list.batches.empty() && list.sortBatches();
+    const std::vector<DrawBatch>& batches = sorted ? list.sortedBatches : list.batches;
+    const Vertex* base = sorted ? list.sortedVertices.data() : list.vertices.data();
+    
+    ctx.renderer->beginFrame(target);
+    if (!batches.empty()) ctx.stats.drawCalls = ctx.renderer->submit(batches, base);
+    ctx.stats.stateCallsAvoided = ctx.renderer->takeAvoidedStateCalls();
+}
+
+// True when endFrame() found the frame unchanged and skipped submit and present
+inline bool wasFrameSkipped() {
+    Context& ctx = getCurrentContext();
+    return ctx.stats.skipped;
+}
+
+// Force the next frame to be submitted in full, e.g. after drawing into the window outside TinyGUI
+inline void invalidateFrame() {
+    Context& ctx = getCurrentContext();
+    ctx.lastFrameValid = false;
+    ctx.damage.valid = false;
+    if (ctx.renderer) ctx.renderer->invalidateState();
+}
+
+// Regions redrawn by the last submitted frame, in logical units
+inline const std::vector<ClipRect>& getDamageRects() {
+    Context& ctx = getCurrentContext();
+    return ctx.damage.rects;
+}
+
+// Window of the current context, for installing GLFW callbacks; null when headless
+inline GLFWwindow* getWindow() {
+    return getCurrentContext().window;
+}
+
+// Backend chosen by init(); apps may upload textures through it directly
+inline Renderer* getRenderer() {
+    Context& ctx = getCurrentContext();
+    return ctx.renderer;
+}
+
+// Run your own GL code where the context is current: queued on the render
+// thread in frame order when there is one, otherwise right away
+inline void runOnRenderThread(std::function<void()> fn) {
+    Context& ctx = getCurrentContext();
+    if (ctx.threaded.running()) ctx.threaded.call(std::move(fn));
+    else fn();
+}
+
+// Block until the render thread has run everything recorded so far
+inline void finishRendering() {
+    Context& ctx = getCurrentContext();
+    ctx.threaded.finish();
+}
+
+// Copy out the frame the next endFrame() presents (or keeps, when it skips the
+// frame). GL backends read into a pixel buffer in the background, so nothing
+// waits for the GPU; the pixels arrive through takeFrameReadback() a frame or
+// two later. Windowless headless modes show frames only this way.
+inline void requestFrameReadback() {
+    Context& ctx = getCurrentContext();
+    ctx.readbackRequested = true;
+}
+
+// Fill in the frame number where a capture pattern has its one integer
+// conversion, such as %05llu or %d; %% is a literal percent. The pattern never
+// reaches printf, so any other conversion, or none, is rejected.
+inline bool formatCapturePath(const std::string& pattern, unsigned long long frame, std::string& out) {
+    std::string path;
+    int conversions = 0;
+    size_t n = pattern.size();
+    for (size_t i = 0; i < n; ++i) {
+        if (pattern[i] != '%') {
+            path += pattern[i];
+            continue;
+        }
+        if (++i < n && pattern[i] == '%') {
+            path += '%';
+            continue;
+        }
+        bool zero = false;
+        int width = 0;
+        for (; i < n && pattern[i] == '0'; ++i) zero = true;
+        for (; i < n && pattern[i] >= '0' && pattern[i] <= '9'; ++i) {
+            width = width * 10 + (pattern[i] - '0');
+            if (width > 64) return false;
+        }
+        for (; i < n && std::string("hljzt").find(pattern[i]) != std::string::npos; ++i) {}  // any size; the frame is printed whole
+        if (i >= n || std::string("diu").find(pattern[i]) == std::string::npos || ++conversions > 1) return false;
+        std::string digits = std::to_string(frame);
+        if ((int)digits.size() < width) path.append(width - digits.size(), zero ? '0' : ' ');
+        path += digits;
+    }
+    if (conversions != 1) return false;
+    out = path;
+    return true;
+}
+
+// Move finished copies out of the renderer: frames with a screenshot path go
+// to the PNG thread, the rest wait for takeFrameReadback()
+inline void collectFrameReadbacks(bool wait) {
+    Context& ctx = getCurrentContext();
+    FrameImage image;
+    while (ctx.renderer && ctx.renderer->takeReadback(image, wait)) {
+        std::string path;
+        auto shot = ctx.screenshotPaths.find(image.frame);
+        if (shot != ctx.screenshotPaths.end()) {
+            path = shot->second;
+            ctx.screenshotPaths.erase(shot);
+        } else if (!ctx.capturePattern.empty()) {
+            formatCapturePath(ctx.capturePattern, image.frame, path);
+        }
+        if (path.empty()) ctx.readbacks.push_back(std::move(image));
+        else ctx.screenshots.write(std::move(image), path);
+    }
+}
+
+// Oldest requested frame whose copy has finished, if any. With `wait` set,
+// blocks for the oldest one still in flight instead, e.g. after the last frame.
+inline bool takeFrameReadback(FrameImage& out, bool wait = false) {
+    Context& ctx = getCurrentContext();
+    if (ctx.readbacks.empty()) collectFrameReadbacks(wait);
+    if (ctx.readbacks.empty()) return false;
+    out = std::move(ctx.readbacks.front());
+    ctx.readbacks.pop_front();
+    return true;
+}
+
+// Read back every frame from now on, skipped ones included. Each arrives a
+// frame or two later, once the readback ring has it. With a `pathPattern` such
+// as "shots/frame_%05llu.png" (one integer conversion, given the frame number)
+// each is written as PNG on the screenshot thread; otherwise take them with
+// takeFrameReadback(). Returns false, capturing nothing, for a pattern that
+// formatCapturePath() rejects.
+inline bool startFrameCapture(const char* pathPattern = nullptr) {
+    Context& ctx = getCurrentContext();
+    std::string probe;
+    if (pathPattern && !formatCapturePath(pathPattern, 0, probe)) {
+        printf("TinyGUI: capture pattern %s needs exactly one integer conversion such as %%05llu\n", pathPattern);
+        return false;
+    }
+    ctx.captureFrames = true;
+    ctx.capturePattern = pathPattern ? pathPattern : "";
+    return true;
+}
+
+// Save the frame the next endFrame() presents as PNG, in the background
+inline void saveScreenshot(const char* path) {
+    Context& ctx = getCurrentContext();
+    ctx.screenshotPaths[ctx.frameCount] = path;
+    ctx.readbackRequested = true;
+}
+
+// Block until every frame read back so far is collected and every screenshot is on disk
+inline void finishScreenshots() {
+    Context& ctx = getCurrentContext();
+    collectFrameReadbacks(true);
+    ctx.screenshots.finish();
+}
+
+// Stop reading back every frame; frames already in flight are still delivered
+inline void stopFrameCapture() {
+    Context& ctx = getCurrentContext();
+    ctx.captureFrames = false;
+    finishScreenshots();
+    ctx.capturePattern.clear();
+}
 
-    double x, y;
-    glfwGetCursorPos(ctx.window, &x, &y);
-    ctx.mouseX = (float)x; // Window coords: origin top-left, Y down (matches our ortho)
-    ctx.mouseY = (float)y;
+// Pixels of the last frame rendered by BACKEND_SOFTWARE (RGBA8, top row first)
+inline const unsigned char* getSoftwareFramebuffer(int* width, int* height) {
+    Context& ctx = getCurrentContext();
+    if (width) *width = ctx.software.width;
+    if (height) *height = ctx.software.height;
+    return ctx.software.framebuffer.empty() ? nullptr : (const unsigned char*)ctx.software.framebuffer.data();
+}
 
-    bool down = glfwGetMouseButton(ctx.window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
-    ctx.mousePressed = down && !ctx.mouseDown;
-    ctx.mouseDown = down;
+// Statistics for the most recently submitted frame
+inline const FrameStats& getFrameStats() {
+    Context& ctx = getCurrentContext();
+    return ctx.stats;
 }
 
-// ==================== Frame Rendering ====================
-inline void beginFrame() {
-    // Use framebuffer size for viewport (pixels)
-    int fbW, fbH;
-    glfwGetFramebufferSize(ctx.window, &fbW, &fbH);
-    glViewport(0, 0, fbW, fbH);
-    glClearColor(0.15f, 0.15f, 0.15f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+// Label cache counters since init(); hits skip tessellation entirely
+inline const LabelCacheStats& getLabelCacheStats() {
+    Context& ctx = getCurrentContext();
+    return ctx.labelCache.stats;
+}
 
-    // Use window size for 2D coordinates (logical units)
-    int w, h;
-    glfwGetWindowSize(ctx.window, &w, &h);
+// Text measurement counters since init(); per-frame counts are in FrameStats
+inline const TextMetricsStats& getTextMetricsStats() {
+    Context& ctx = getCurrentContext();
+    return ctx.textMetrics.stats;
+}
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    // Top-left origin, Y down
-    glOrtho(0, w, h, 0, -1, 1);
+// Change the label cache size at runtime, evicting as needed; 0 disables it
+inline void setLabelCacheBudget(size_t bytes) {
+    Context& ctx = getCurrentContext();
+    ctx.labelCache.budget = bytes;
+    ctx.labelCache.trim();
+}
 
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+// Switch analytic antialiasing of lines and outlines on or off
+inline void setLineAntialiasing(bool enabled) {
+    Context& ctx = getCurrentContext();
+    ctx.antialiasLines = enabled;
 }
 
 // endFrame will be defined after menu functions
@@ -297,50 +4349,375 @@ inline void endFrame();
 
 // Get the menu result from the last frame
 inline int getMenuResult() {
+    Context& ctx = getCurrentContext();
     int result = ctx.pendingMenuResult;
     ctx.pendingMenuResult = -1; // Clear after reading
     return result;
 }
 
 // ==================== Utility Functions ====================
+// True when a box lies entirely outside the current clip, so it can be
+// skipped before generating any geometry
+inline bool isClipped(float x, float y, float w, float h) {
+    Context& ctx = getCurrentContext();
+    return ctx.drawList.clip.rejects(std::min(x, x + w), std::min(y, y + h),
+                                     std::max(x, x + w), std::max(y, y + h));
+}
+
+// Textured axis-aligned quad, (u0, v0) at (x0, y0) to (u1, v1) at (x1, y1).
+// A quad past the vertex limit is cut to the clip rect, with texture coords
+// interpolated to match; one with nothing left collapses to zero area.
+inline void setQuad(Vertex* v, float x0, float y0, float x1, float y1,
+                    float u0, float v0, float u1, float v1, const Color& color) {
+    const float lim = TINYGUI_VERTEX_LIMIT;
+    if (std::min(x0, x1) < -lim || std::max(x0, x1) > lim || std::min(y0, y1) < -lim || std::max(y0, y1) > lim) {
+        const ClipRect& clip = getCurrentContext().drawList.clip;
+        auto cut = [](float& a0, float& a1, float& t0, float& t1, float lo, float hi) {
+            float c0 = std::max(lo, std::min(hi, a0)), c1 = std::max(lo, std::min(hi, a1));
+            if (a1 != a0) {
+                float k = (t1 - t0) / (a1 - a0);
+                float n0 = t0 + (c0 - a0) * k;
+                t1 = t0 + (c1 - a0) * k;
+                t0 = n0;
+            }
+            a0 = c0; a1 = c1;
+        };
+        cut(x0, x1, u0, u1, std::max(-lim, clip.x), std::min(lim, clip.x + clip.w));
+        cut(y0, y1, v0, v1, std::max(-lim, clip.y), std::min(lim, clip.y + clip.h));
+    }
+    setVertex(v + 0, x0, y0, u0, v0, color);
+    setVertex(v + 1, x1, y0, u1, v0, color);
+    setVertex(v + 2, x1, y1, u1, v1, color);
+    setVertex(v + 3, x0, y1, u0, v1, color);
+}
+
+// Cut a segment to a box (Liang-Barsky); false when nothing is left
+inline bool clipSegment(float& x1, float& y1, float& x2, float& y2, float bx0, float by0, float bx1, float by1) {
+    float dx = x2 - x1, dy = y2 - y1, t0 = 0.0f, t1 = 1.0f;
+    float p[4] = {-dx, dx, -dy, dy}, q[4] = {x1 - bx0, bx1 - x1, y1 - by0, by1 - y1};
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0.0f) {
+            if (q[i] < 0.0f) return false;
+            continue;
+        }
+        float r = q[i] / p[i];
+        if (p[i] < 0.0f) t0 = std::max(t0, r);
+        else t1 = std::min(t1, r);
+    }
+    if (t0 >= t1) return false;
+    float ox = x1, oy = y1;
+    x1 = ox + dx * t0; y1 = oy + dy * t0;
+    x2 = ox + dx * t1; y2 = oy + dy * t1;
+    return true;
+}
+
 inline void drawRect(float x, float y, float w, float h, const Color& color = COLOR_WHITE) {
-    color.apply();
-    glBegin(GL_QUADS);
-    glVertex2f(x, y);
-    glVertex2f(x + w, y);
-    glVertex2f(x + w, y + h);
-    glVertex2f(x, y + h);
-    glEnd();
+    Context& ctx = getCurrentContext();
+    if (isClipped(x, y, w, h)) return;
+    Vertex* v = ctx.drawList.alloc(PRIM_QUADS, 4);
+    setVertex(v + 0, x, y, 0, 0, color);
+    setVertex(v + 1, x + w, y, 0, 0, color);
+    setVertex(v + 2, x + w, y + h, 0, 0, color);
+    setVertex(v + 3, x, y + h, 0, 0, color);
+}
+
+// Lines are quads like everything else, so outlines land in the same batch as
+// the fills they surround. Aliased lines round their width to whole units the
+// way GL lines did; antialiased ones keep the exact width and draw the pixels
+// an edge only partly covers with alpha scaled by that coverage.
+inline float lineWidthFor(float thickness) {
+    Context& ctx = getCurrentContext();
+    return ctx.antialiasLines ? std::max(0.0f, thickness) : std::max(1.0f, std::floor(thickness + 0.5f));
+}
+
+// Device pixels per logical unit
+inline float framebufferScale() {
+    Context& ctx = getCurrentContext();
+    return ctx.displayW > 0 ? (float)ctx.framebufferW / ctx.displayW : 1.0f;
+}
+
+// Axis-aligned band of a line: [a0, a1) along it, [b0, b1) across it
+inline void drawLineBand(bool horizontal, float a0, float a1, float b0, float b1, const Color& color) {
+    Context& ctx = getCurrentContext();
+    if (a1 <= a0 || b1 <= b0) return;
+    auto span = [&](float s0, float s1, float coverage) {
+        Color c(color.r, color.g, color.b, color.a * coverage);
+        if (horizontal) drawRect(a0, s0, a1 - a0, s1 - s0, c);
+        else drawRect(s0, a0, s1 - s0, a1 - a0, c);
+    };
+    if (!ctx.antialiasLines) {
+        span(b0, b1, 1.0f);
+        return;
+    }
+    // Box-filter coverage: a solid core plus the partial pixel at each edge
+    float k = framebufferScale();
+    float p0 = b0 * k, p1 = b1 * k;
+    float first = std::floor(p0), last = std::floor(p1);
+    if (first == last) {
+        span(first / k, (first + 1) / k, p1 - p0);
+        return;
+    }
+    if (p0 > first) {
+        span(first / k, (first + 1) / k, first + 1 - p0);
+        first += 1;
+    }
+    if (last > first) span(first / k, last / k, 1.0f);
+    if (p1 > last) span(last / k, (last + 1) / k, p1 - last);
+}
+
+// Parallelogram from offsets d0 to d1 along the unit normal (nx, ny)
+inline void drawLineQuad(float x1, float y1, float x2, float y2, float nx, float ny, float d0, float d1, const Color& color) {
+    Context& ctx = getCurrentContext();
+    Vertex* v = ctx.drawList.alloc(PRIM_QUADS, 4);
+    setVertex(v + 0, x1 + nx * d0, y1 + ny * d0, 0, 0, color);
+    setVertex(v + 1, x2 + nx * d0, y2 + ny * d0, 0, 0, color);
+    setVertex(v + 2, x2 + nx * d1, y2 + ny * d1, 0, 0, color);
+    setVertex(v + 3, x1 + nx * d1, y1 + ny * d1, 0, 0, color);
 }
 
 inline void drawRectOutline(float x, float y, float w, float h, const Color& color = COLOR_WHITE, float thickness = 1.0f) {
-    color.apply();
-    glLineWidth(thickness);
-    glBegin(GL_LINE_LOOP);
-    glVertex2f(x, y);
-    glVertex2f(x + w, y);
-    glVertex2f(x + w, y + h);
-    glVertex2f(x, y + h);
-    glEnd();
-    glLineWidth(1.0f);
+    Context& ctx = getCurrentContext();
+    float t = lineWidthFor(thickness), half = t * 0.5f;
+    if (isClipped(x - half, y - half, w + t, h + t)) return;
+    // Top and bottom span the corners; the sides fit between them so no pixel blends twice
+    drawLineBand(true, x - half, x + w + half, y - half, y + half, color);
+    drawLineBand(true, x - half, x + w + half, y + h - half, y + h + half, color);
+    float s0 = y + half, s1 = y + h - half;
+    if (ctx.antialiasLines) {
+        float k = framebufferScale();
+        s0 = std::ceil(s0 * k) / k;
+        s1 = std::floor(s1 * k) / k;
+    }
+    if (s1 <= s0) return;
+    drawLineBand(false, s0, s1, x - half, x + half, color);
+    drawLineBand(false, s0, s1, x + w - half, x + w + half, color);
 }
 
 inline void drawLine(float x1, float y1, float x2, float y2, const Color& color = COLOR_WHITE, float thickness = 1.0f) {
-    color.apply();
-    glLineWidth(thickness);
-    glBegin(GL_LINES);
-    glVertex2f(x1, y1);
-    glVertex2f(x2, y2);
-    glEnd();
-    glLineWidth(1.0f);
+    Context& ctx = getCurrentContext();
+    float t = lineWidthFor(thickness), half = t * 0.5f;
+    if (isClipped(std::min(x1, x2) - half, std::min(y1, y2) - half,
+                  std::fabs(x2 - x1) + t, std::fabs(y2 - y1) + t)) return;
+    if (y1 == y2) {
+        drawLineBand(true, std::min(x1, x2), std::max(x1, x2), y1 - half, y1 + half, color);
+        return;
+    }
+    if (x1 == x2) {
+        drawLineBand(false, std::min(y1, y2), std::max(y1, y2), x1 - half, x1 + half, color);
+        return;
+    }
+    // Slanted quads can't be clamped corner by corner, so a line reaching past
+    // the vertex limit is cut to the clip rect, with room for its width
+    float margin = t + 2.0f, lim = TINYGUI_VERTEX_LIMIT - margin;
+    if (std::max(std::max(std::fabs(x1), std::fabs(x2)), std::max(std::fabs(y1), std::fabs(y2))) > lim) {
+        const ClipRect& clip = ctx.drawList.clip;
+        if (!clipSegment(x1, y1, x2, y2,
+                         std::max(-lim, clip.x - margin), std::max(-lim, clip.y - margin),
+                         std::min(lim, clip.x + clip.w + margin), std::min(lim, clip.y + clip.h + margin))) return;
+    }
+    float dx = x2 - x1, dy = y2 - y1;
+    float len = std::sqrt(dx * dx + dy * dy);
+    float nx = -dy / len, ny = dx / len;
+    if (!ctx.antialiasLines) {
+        drawLineQuad(x1, y1, x2, y2, nx, ny, -half, half, color);
+        return;
+    }
+    // Slanted edges cross pixels at every phase, so a one-pixel fringe at half
+    // alpha (the mean of a linear ramp) stands in for exact coverage
+    float px = 1.0f / framebufferScale();
+    float core = std::max(0.0f, t - px) * 0.5f;
+    Color fringe(color.r, color.g, color.b, color.a * 0.5f * std::min(1.0f, t / px));
+    if (core > 0.0f) drawLineQuad(x1, y1, x2, y2, nx, ny, -core, core, color);
+    drawLineQuad(x1, y1, x2, y2, nx, ny, -core - px, -core, fringe);
+    drawLineQuad(x1, y1, x2, y2, nx, ny, core, core + px, fringe);
+}
+
+// Clip subsequently recorded geometry to a rect in window coords. Clips nest:
+// the new rect is intersected with the current one until popClipRect().
+inline void pushClipRect(float x, float y, float w, float h) {
+    Context& ctx = getCurrentContext();
+    DrawList& list = ctx.drawList;
+    ctx.clipStack.push_back(list.clip);
+    list.clip = list.clip.intersect(ClipRect(x, y, w, h));
+}
+
+inline void popClipRect() {
+    Context& ctx = getCurrentContext();
+    if (ctx.clipStack.empty()) return;
+    ctx.drawList.clip = ctx.clipStack.back();
+    ctx.clipStack.pop_back();
+}
+
+inline const ClipRect& getClipRect() {
+    Context& ctx = getCurrentContext();
+    return ctx.drawList.clip;
+}
+
+// ==================== Cached Regions ====================
+// Everything drawn between beginCachedRegion() and endCachedRegion() is
+// rendered once into an offscreen layer; later frames draw the layer as a
+// single textured quad. Widgets inside still run every frame (they handle
+// input), and the layer is re-rendered when the recorded geometry hashes
+// differently or after invalidateCachedRegion(). The layer is opaque over
+// THEME_BG, so use it for panels drawn on the window background. Regions do
+// not nest.
+inline void beginCachedRegion(const char* id, float x, float y, float w, float h) {
+    Context& ctx = getCurrentContext();
+    if (ctx.openRegion) {
+        printf("TinyGUI: cached region '%s' opened inside another one, ignored\n", id);
+        return;
+    }
+    CachedRegion& region = ctx.cachedRegions[id];
+    if (region.x != x || region.y != y || region.w != w || region.h != h ||
+        region.framebufferW != ctx.framebufferW || region.framebufferH != ctx.framebufferH) {
+        // New size: the old layer texture cannot be reused
+        if (region.texture) ctx.renderer->releaseTexture(region.texture);
+        region.texture = 0;
+        region.valid = false;
+        region.x = x; region.y = y; region.w = w; region.h = h;
+        region.framebufferW = ctx.framebufferW; region.framebufferH = ctx.framebufferH;
+    }
+    ctx.openRegion = &region;
+    pushClipRect(x, y, w, h);
+    ctx.drawList.seal();
+    ctx.regionFirstVertex = ctx.drawList.vertices.size();
+    ctx.regionFirstBatch = ctx.drawList.batches.size();
+}
+
+inline void endCachedRegion() {
+    Context& ctx = getCurrentContext();
+    if (!ctx.openRegion) return;
+    CachedRegion& region = *ctx.openRegion;
+    ctx.openRegion = nullptr;
+    popClipRect();
+    
+    // The region's geometry, rebased to start at vertex 0
+    DrawList& list = ctx.drawList;
+    ctx.regionBatches.assign(list.batches.begin() + ctx.regionFirstBatch, list.batches.end());
+    for (DrawBatch& batch : ctx.regionBatches) batch.first -= (int)ctx.regionFirstVertex;
+    const Vertex* verts = list.vertices.data() + ctx.regionFirstVertex;
+    size_t count = list.vertices.size() - ctx.regionFirstVertex;
+    unsigned long long hash = hashWords(verts, count * sizeof(Vertex));
+    hash = hashWords(ctx.regionBatches.data(), ctx.regionBatches.size() * sizeof(DrawBatch), hash);
+    
+    if (!region.valid || hash != region.hash) {
+        ClipRect rect(region.x, region.y, region.w, region.h);
+        FrameTarget target(ctx.displayW, ctx.displayH, ctx.framebufferW, ctx.framebufferH, THEME_BG);
+        region.texture = ctx.renderer->renderLayer(region.texture, rect, target, ctx.regionBatches, verts);
+        region.hash = hash;
+        region.valid = region.texture != 0;
+        if (!region.valid) return;  // backend has no layers: keep drawing the geometry directly
+        ctx.changedLayers.push_back(rect);
+    }
+    
+    // Swap the recorded geometry for the layer
+    list.vertices.resize(ctx.regionFirstVertex);
+    list.batches.resize(ctx.regionFirstBatch);
+    list.seal();
+    float v0 = 0.0f, v1 = 1.0f;
+    if (ctx.renderer->layerRowsBottomUp()) std::swap(v0, v1);
+    float x = region.x, y = region.y, w = region.w, h = region.h;
+    Vertex* v = list.alloc(PRIM_QUADS, 4, region.texture);
+    setQuad(v, x, y, x + w, y + h, 0.0f, v0, 1.0f, v1, COLOR_WHITE);
+}
+
+// Force the region to be re-rendered the next time it is drawn
+inline void invalidateCachedRegion(const char* id) {
+    Context& ctx = getCurrentContext();
+    auto it = ctx.cachedRegions.find(id);
+    if (it != ctx.cachedRegions.end()) it->second.valid = false;
+}
+
+// ==================== Fonts ====================
+// Register a TrueType font under `name`; the bytes are copied
+inline bool loadFontFromData(const char* name, const unsigned char* data, size_t size) {
+    Context& ctx = getCurrentContext();
+    // Parse on the side so a failed reload keeps the font already under this name
+    Font loaded;
+    if (!loaded.face.load(data, size)) return false;
+    for (int c = 0; c < 128; ++c) loaded.advances[c] = loaded.face.advance(loaded.face.glyphIndex(c));
+    loaded.id = ++ctx.fontCount;   // glyphs of a font previously loaded under this name age out of the atlas
+    Font& font = ctx.fonts[name];
+    font = std::move(loaded);      // moving the byte buffer keeps stbtt_fontinfo's pointer into it valid
+    return true;
+}
+
+inline bool loadFontFromFile(const char* name, const char* filepath) {
+    std::vector<unsigned char> bytes;
+    if (FILE* f = fopen(filepath, "rb")) {
+        unsigned char chunk[65536];
+        for (size_t n; (n = fread(chunk, 1, sizeof(chunk), f)) > 0; ) bytes.insert(bytes.end(), chunk, chunk + n);
+        fclose(f);
+    }
+    if (bytes.empty() || !loadFontFromData(name, bytes.data(), bytes.size())) {
+        printf("Failed to load font: %s\n", filepath);
+        return false;
+    }
+    return true;
+}
+
+// Draw and measure text with a loaded font; null or an unknown name selects the built-in font
+inline bool setFont(const char* name) {
+    Context& ctx = getCurrentContext();
+    auto it = name ? ctx.fonts.find(name) : ctx.fonts.end();
+    ctx.font = it != ctx.fonts.end() ? &it->second : nullptr;
+    return ctx.font != nullptr;
+}
+
+// Width and height of `text` at `scale` with the active font, from the
+// measurement cache when the string was seen before
+inline void measureText(const char* text, float scale, float& width, float& height) {
+    Context& ctx = getCurrentContext();
+    int font = ctx.font ? ctx.font->id : 0;
+    float perUnit = ctx.font ? ctx.font->unitScale(scale) : scale;
+    unsigned long long key = TextMetricsCache::keyOf(text, font);
+    if (const TextMetricsCache::Entry* e = ctx.textMetrics.find(key, text, font)) {
+        width = e->width * perUnit;
+        height = e->height * perUnit;
+        return;
+    }
+    float units = 0;
+    if (ctx.font) {
+        float line = 0;
+        for (const char* p = text; *p; ) {
+            int cp = decodeUTF8(p);
+            if (cp == '\n') { units = std::max(units, line); line = 0; }
+            else line += ctx.font->advanceUnits(cp);
+        }
+        units = std::max(units, line);
+    } else {
+        units = (float)stb_easy_font_width((char*)text);
+    }
+    // stb_easy_font_height() counts 12 per line; a loaded font spaces lines by its own pitch
+    float tall = (float)stb_easy_font_height((char*)text);
+    if (ctx.font) tall = tall / 12.0f * ctx.font->lineUnits();
+    ctx.textMetrics.insert(key, text, font, units, tall);
+    width = units * perUnit;
+    height = tall * perUnit;
 }
 
 inline float measureTextWidth(const char* text, float scale = TINYGUI_LABEL_SCALE) {
-    return stb_easy_font_width((char*)text) * scale;
+    float width, height;
+    measureText(text, scale, width, height);
+    return width;
 }
 
 inline float measureTextHeight(const char* text, float scale = TINYGUI_LABEL_SCALE) {
-    return stb_easy_font_height((char*)text) * scale;
+    float width, height;
+    measureText(text, scale, width, height);
+    return height;
+}
+
+// Distance between the baselines of consecutive lines with the active font
+inline float textLineHeight(float scale = TINYGUI_LABEL_SCALE) {
+    Context& ctx = getCurrentContext();
+    return ctx.font ? ctx.font->lineHeight(scale) : 12.0f * scale;
+}
+
+// Height of the glyphs below a label's y, for carets and selection bars
+inline float textGlyphHeight(float scale = TINYGUI_LABEL_SCALE) {
+    Context& ctx = getCurrentContext();
+    return ctx.font ? TINYGUI_FONT_PIXEL_HEIGHT * scale : 8.0f * scale;
 }
 
 inline bool pointInRect(float px, float py, float x, float y, float w, float h) {
@@ -361,16 +4738,12 @@ inline bool isModalVisible();
 // ==================== Image System ====================
 // Image loading function declarations (implementations after widgets)
 inline bool loadImageFromData(const char* name, unsigned char* pixels, int width, int height) {
+    Context& ctx = getCurrentContext();
     ImageData& img = ctx.imageCache[name];
     if (img.loaded) return true;
     
-    glGenTextures(1, &img.textureID);
-    glBindTexture(GL_TEXTURE_2D, img.textureID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    img.textureID = ctx.renderer->uploadTexture(pixels, width, height);
+    if (!img.textureID) return false;
     img.width = width; img.height = height; img.loaded = true;
     return true;
 }
@@ -413,34 +4786,181 @@ inline bool loadImageFromFile(const char* name, const char* filepath) {
 }
 
 // ==================== GUI Widgets ====================
+// Atlas entry for a TrueType glyph at sizeQ quarter pixels, rasterized on first
+// use; null when the atlas has no room left this frame
+inline FontAtlas::Entry* fontGlyph(const Font& font, int glyph, int sizeQ) {
+    Context& ctx = getCurrentContext();
+    FontAtlas& atlas = ctx.fontAtlas;
+    unsigned long long key = FontAtlas::keyOf(font.id, glyph, sizeQ);
+    if (FontAtlas::Entry* entry = atlas.find(key)) return entry;
+    if (!atlas.texture) {
+        // Largest power-of-two square within the budget
+        atlas.size = 64;
+        while ((size_t)atlas.size * atlas.size * 16 <= atlas.budget) atlas.size *= 2;
+        atlas.texture = ctx.renderer->uploadTexture(nullptr, atlas.size, atlas.size);
+        if (!atlas.texture) return nullptr;
+        atlas.packer.reset(atlas.size, atlas.size);
+    }
+    
+    FontAtlas::Entry entry;
+    entry.key = key;
+    entry.lastFrame = atlas.frame;
+    entry.slot = FontAtlas::Slot{0, 0, 0, 0};
+    std::vector<unsigned char> alpha;
+    float unit = sizeQ / 4.0f / (font.face.ascent - font.face.descent);
+    font.face.rasterize(glyph, unit, alpha, entry.width, entry.height, entry.left, entry.top);
+    if (entry.width > 0) {
+        if (!atlas.allocate(entry.width, entry.height, entry.slot)) return nullptr;
+        // The whole slot is written so padding and reused slots come out transparent
+        const FontAtlas::Slot& slot = entry.slot;
+        std::vector<unsigned char> rgba((size_t)slot.w * slot.h * 4, 0);
+        for (int y = 0; y < entry.height; ++y) {
+            for (int x = 0; x < entry.width; ++x) {
+                unsigned char* px = &rgba[((size_t)y * slot.w + x) * 4];
+                px[0] = px[1] = px[2] = 255;
+                px[3] = alpha[(size_t)y * entry.width + x];
+            }
+        }
+        ctx.renderer->updateTexture(atlas.texture, slot.x, slot.y, slot.w, slot.h, rgba.data());
+    }
+    atlas.entries.push_front(entry);
+    atlas.index[key] = atlas.entries.begin();
+    return &atlas.entries.front();
+}
+
+// Glyph quads land on whole framebuffer pixels so atlas texels map 1:1
+inline void drawFontText(const Font& font, float x, float y, const char* text, float scale, const Color& color) {
+    Context& ctx = getCurrentContext();
+    float k = framebufferScale();
+    int sizeQ = std::max(1, std::min(0xFFFFFF, (int)std::lround(TINYGUI_FONT_PIXEL_HEIGHT * scale * k * 4)));
+    float lineHeight = font.lineHeight(scale) * k;
+    float startX = x * k, penX = startX;
+    float baseline = std::round(y * k + font.face.ascent * font.unitScale(scale) * k);
+    for (const char* p = text; *p; ) {
+        int cp = decodeUTF8(p);
+        if (cp == '\n') { penX = startX; baseline += lineHeight; continue; }
+        const FontAtlas::Entry* g = fontGlyph(font, font.face.glyphIndex(cp), sizeQ);
+        if (g && g->width > 0) {
+            float inv = 1.0f / ctx.fontAtlas.size;
+            float x0 = (std::round(penX) + g->left) / k, y0 = (baseline + g->top) / k;
+            float x1 = x0 + g->width / k, y1 = y0 + g->height / k;
+            float u0 = g->slot.x * inv, v0 = g->slot.y * inv;
+            float u1 = (g->slot.x + g->width) * inv, v1 = (g->slot.y + g->height) * inv;
+            Vertex* v = ctx.drawList.alloc(PRIM_QUADS, 4, ctx.fontAtlas.texture);
+            setQuad(v, x0, y0, x1, y1, u0, v0, u1, v1, color);
+        }
+        penX += font.advance(cp, scale) * k;
+    }
+}
+
+// Atlas for text drawn at `scale`, or null when the scale is not a whole number
+// of framebuffer pixels per font unit
+inline GlyphAtlas* glyphAtlasFor(float scale) {
+    Context& ctx = getCurrentContext();
+    float k = framebufferScale();
+    float texels = scale * k;
+    int bucket = (int)texels;
+    if (bucket < 1 || bucket > TINYGUI_MAX_ATLAS_SCALE || bucket != texels) return nullptr;
+    GlyphAtlas& atlas = ctx.glyphAtlases[bucket];
+    if (!atlas.scale) atlas.build(ctx.renderer, bucket);
+    return atlas.texture ? &atlas : nullptr;
+}
+
+// One quad per character. The origin snaps to the pixel the first segment
+// edge would land on (GL's tie rules, y pointing down), so every glyph covers
+// exactly the pixels of its segments. Returns false for text outside the atlas.
+inline bool drawGlyphs(const GlyphAtlas& atlas, float x, float y, const char* text, float scale, const Color& color) {
+    Context& ctx = getCurrentContext();
+    int count = 0;
+    for (const unsigned char* p = (const unsigned char*)text; *p; ++p) {
+        if (*p == '\n') continue;
+        if (*p < TINYGUI_GLYPH_FIRST || *p >= TINYGUI_GLYPH_FIRST + TINYGUI_GLYPH_COUNT) return false;
+        const GlyphAtlas::Glyph& g = atlas.glyphs[*p - TINYGUI_GLYPH_FIRST];
+        if (g.x1 > g.x0) ++count;
+    }
+    if (count == 0) return true;
+    
+    float k = (float)atlas.scale / scale;   // framebuffer pixels per logical unit
+    float ox = std::ceil(x * k - 0.5f) / k, oy = (std::floor(y * k - 0.5f) + 1) / k;
+    Vertex* v = ctx.drawList.alloc(PRIM_QUADS, count * 4, atlas.texture);
+    float penX = 0, penY = 0;
+    for (const unsigned char* p = (const unsigned char*)text; *p; ++p) {
+        if (*p == '\n') { penX = 0; penY += 12; continue; }
+        const GlyphAtlas::Glyph& g = atlas.glyphs[*p - TINYGUI_GLYPH_FIRST];
+        if (g.x1 > g.x0) {
+            float x0 = ox + (penX + g.x0) * scale, x1 = ox + (penX + g.x1) * scale;
+            float y0 = oy + (penY + g.y0) * scale, y1 = oy + (penY + g.y1) * scale;
+            setQuad(v, x0, y0, x1, y1, g.u0, g.v0, g.u1, g.v1, color);
+            v += 4;
+        }
+        penX += (stb_easy_font_charinfo[*p - TINYGUI_GLYPH_FIRST].advance & 15) + stb_easy_font_spacing_val;
+    }
+    return true;
+}
+
 inline void label(float x, float y, const char* text, float scale = TINYGUI_LABEL_SCALE, const Color& color = THEME_TEXT) {
-    glPushMatrix();
-    glTranslatef(x, y, 0);
-    glScalef(scale, scale, 1.0f);
+    Context& ctx = getCurrentContext();
+    DrawList& list = ctx.drawList;
+    // Cheap rejection before tessellating: stb_easy_font lines are 12 units tall
+    const ClipRect& clip = list.clip;
+    if (x >= clip.x + clip.w || y >= clip.y + clip.h) return;
+    if (x < clip.x || y < clip.y) {
+        float w, h;
+        measureText(text, scale, w, h);
+        if (x + w <= clip.x || y + h <= clip.y) return;
+    }
+
+    if (ctx.font) {
+        drawFontText(*ctx.font, x, y, text, scale, color);
+        return;
+    }
+    if (GlyphAtlas* atlas = glyphAtlasFor(scale)) {
+        if (drawGlyphs(*atlas, x, y, text, scale, color)) return;
+    }
 
-    // Each char uses 64 bytes (4 verts * 16 bytes); allow generous buffer
-    char buffer[16384];
-    int num_quads = stb_easy_font_print(0, 0, (char*)text, NULL, buffer, sizeof(buffer));
+    // Vertices are stored scaled but untranslated, so a hit is a copy plus an offset
+    LabelCache& cache = ctx.labelCache;
+    int dx = quantizeVertex(x, TINYGUI_VERTEX_SUBPIXELS), dy = quantizeVertex(y, TINYGUI_VERTEX_SUBPIXELS);
+    unsigned long long key = 0;
+    if (cache.budget > 0) {
+        key = LabelCache::keyOf(text, scale, color);
+        if (const std::vector<Vertex>* cached = cache.find(key, text, scale, color)) {
+            if (cached->empty()) return;
+            Vertex* v = list.alloc(PRIM_QUADS, (int)cached->size());
+            std::memcpy(v, cached->data(), cached->size() * sizeof(Vertex));
+            for (size_t i = 0; i < cached->size(); ++i) offsetVertex(v + i, dx, dy);
+            return;
+        }
+    }
 
-    color.apply();
-    glEnableClientState(GL_VERTEX_ARRAY);
-    glVertexPointer(2, GL_FLOAT, 16, buffer);
-    glDrawArrays(GL_QUADS, 0, num_quads * 4);
-    glDisableClientState(GL_VERTEX_ARRAY);
+    // stb_easy_font emits 4 verts * 16 bytes per quad and several quads per char
+    size_t need = std::max<size_t>(16384, std::strlen(text) * 1024);
+    if (list.scratch.size() < need) list.scratch.resize(need);
+    int num_quads = stb_easy_font_print(0, 0, (char*)text, NULL, list.scratch.data(), (int)list.scratch.size());
 
-    glPopMatrix();
+    std::vector<Vertex> local(num_quads * 4);
+    const float* src = (const float*)list.scratch.data();
+    for (int i = 0; i < num_quads * 4; ++i, src += 4) {
+        setVertex(&local[i], src[0] * scale, src[1] * scale, 0, 0, color);
+    }
+    if (num_quads > 0) {
+        // Transform on the CPU so text shares batches with surrounding geometry
+        Vertex* v = list.alloc(PRIM_QUADS, num_quads * 4);
+        std::memcpy(v, local.data(), local.size() * sizeof(Vertex));
+        for (int i = 0; i < num_quads * 4; ++i) offsetVertex(v + i, dx, dy);
+    }
+    if (cache.budget > 0) cache.insert(key, text, scale, color, local);
 }
 
 // Helper function to calculate minimum button size for text + padding
 inline void getMinButtonSize(const char* text, float& minW, float& minH, float padding = 8.0f) {
-    const float s = TINYGUI_LABEL_SCALE;
-    int tw = stb_easy_font_width((char*)text);
-    int th = stb_easy_font_height((char*)text);
-    minW = tw * s + 2 * padding;
-    minH = th * s + 2 * padding;
+    measureText(text, TINYGUI_LABEL_SCALE, minW, minH);
+    minW += 2 * padding;
+    minH += 2 * padding;
 }
 
 inline bool button(float x, float y, float w, float h, const char* text) {
+    Context& ctx = getCurrentContext();
     // Hit-test in window coords (no Y flip)
     bool hovered = pointInRect(ctx.mouseX, ctx.mouseY, x, y, w, h);
     bool pressed = hovered && ctx.mouseDown;
@@ -451,12 +4971,10 @@ inline bool button(float x, float y, float w, float h, const char* text) {
     
     drawRect(x, y, w, h, buttonColor);
 
-    // Center text using stb metrics at the same scale as label
+    // Center text using the active font's metrics at the same scale as label
     const float s = TINYGUI_LABEL_SCALE;
-    int tw = stb_easy_font_width((char*)text);
-    int th = stb_easy_font_height((char*)text);
-    float textW = tw * s;
-    float textH = th * s;
+    float textW, textH;
+    measureText(text, s, textW, textH);
     
     // Always center text perfectly within the button bounds
     float tx = x + (w - textW) * 0.5f;
@@ -479,6 +4997,7 @@ inline bool autoButton(float x, float y, const char* text, float padding = 8.0f)
 
 // Single vertical tab button
 inline bool verticalTab(float x, float y, float w, float h, const char* text, bool isActive, bool showIcon = false) {
+    Context& ctx = getCurrentContext();
     bool hovered = pointInRect(ctx.mouseX, ctx.mouseY, x, y, w, h);
     bool pressed = hovered && ctx.mouseDown;
     
@@ -502,8 +5021,8 @@ inline bool verticalTab(float x, float y, float w, float h, const char* text, bo
     
     // Draw text (rotated or horizontal depending on preference)
     const float s = 1.8f; // Slightly smaller text for sidebar
-    float textW = measureTextWidth(text, s);
-    float textH = measureTextHeight(text, s);
+    float textW, textH;
+    measureText(text, s, textW, textH);
     
     // Center text in the tab
     float tx = x + (w - textW) * 0.5f;
@@ -520,12 +5039,11 @@ inline bool verticalTab(float x, float y, float w, float h, const char* text, bo
 
 // Vertical sidebar tab bar
 inline int verticalTabBar(float x, float y, float w, const char** tabNames, int tabCount, int& activeTab, float tabHeight = 50.0f) {
+    Context& ctx = getCurrentContext();
     if (tabCount <= 0) return -1;
     
     // Draw sidebar background
-    int windowW, windowH;
-    glfwGetWindowSize(ctx.window, &windowW, &windowH);
-    float sidebarHeight = windowH - y;
+    float sidebarHeight = ctx.displayH - y;
     drawRect(x, y, w, sidebarHeight, Color(0.15f, 0.15f, 0.15f, 1.0f));
     
     int clickedTab = -1;
@@ -553,28 +5071,36 @@ inline float getSidebarWidth() {
 
 // ==================== Input Box (with caret & selection) ====================
 inline bool input(float x, float y, float w, float h, InputState& inputState, const char* hint = "") {
+    Context& ctx = getCurrentContext();
     bool inside = pointInRect(ctx.mouseX, ctx.mouseY, x, y, w, h);
     bool isActive = (ctx.activeInput == &inputState);
 
-    bool shiftDown = glfwGetKey(ctx.window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS ||
-                     glfwGetKey(ctx.window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS;
+    bool shiftDown = isKeyDown(GLFW_KEY_LEFT_SHIFT) || isKeyDown(GLFW_KEY_RIGHT_SHIFT);
 
     const float s = TINYGUI_LABEL_SCALE;
     const float padX = 5.0f, padY = 5.0f;
-    const float lineH = 8.0f * s;
+    const float lineH = textGlyphHeight(s);
     const float textAreaW = w - 2 * padX;
 
-    // Precompute character widths for current text
-    float charWidths[TINYGUI_MAX_TEXT]{};
-    float cumWidths[TINYGUI_MAX_TEXT]{};
-    float totalTextWidth = 0.0f;
-    int len = computeCharWidths(inputState.text, s, charWidths, cumWidths, TINYGUI_MAX_TEXT - 1, &totalTextWidth);
+    // Caret positions, kept up to date by the editing helpers
+    syncInputWidths(&inputState, s);
+    int len = textLen(&inputState);
+    float totalTextWidth = inputState.widthBefore(len);
 
     // Calculate caret position and adjust scroll offset
     auto caretXAt = [&](int idx) -> float {
-        if (idx <= 0) return 0.0f;
-        if (idx >= len) return totalTextWidth;
-        return cumWidths[idx];
+        return inputState.widthBefore(std::max(0, std::min(idx, len)));
+    };
+    // First caret position whose x passes `limit` (>= with orEqual), by binary search
+    auto firstPast = [&](float limit, bool orEqual) -> int {
+        int lo = 0, hi = len + 1;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            float cx = inputState.widthBefore(mid);
+            if (orEqual ? cx >= limit : cx > limit) hi = mid;
+            else lo = mid + 1;
+        }
+        return lo;
     };
 
     // Ensure caret is visible by adjusting scroll offset
@@ -601,24 +5127,25 @@ inline bool input(float x, float y, float w, float h, InputState& inputState, co
         if (lx <= 0.0f) return 0;
         if (lx >= totalTextWidth) return len;
         
-        // Find the character position closest to the mouse
-        for (int i = 0; i < len; ++i) {
-            float charStart = cumWidths[i];
-            float charEnd = charStart + charWidths[i];
-            float charMid = (charStart + charEnd) * 0.5f;
-            if (lx < charMid) return i;
-        }
-        return len;
+        // First character whose midpoint lies right of the mouse; midpoints only grow
+        int lo = 0, hi = len;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (lx < (caretXAt(mid) + caretXAt(mid + 1)) * 0.5f) hi = mid;
+            else lo = mid + 1;
+        }
+        return lo;
     };
 
     if (ctx.mousePressed && inside) {
         ctx.activeInput = &inputState;
+        ctx.activeTextArea = nullptr;
         isActive = true;
         int newCaret = indexFromX(ctx.mouseX);
         if (!shiftDown) inputState.selAnchor = newCaret;
         inputState.caret = newCaret;
         inputState.selecting = true;
-        glfwFocusWindow(ctx.window);
+        if (ctx.window) glfwFocusWindow(ctx.window);
         resetBlink(&inputState);
     } else if (ctx.mousePressed && !inside && isActive) {
         ctx.activeInput = nullptr;
@@ -637,11 +5164,8 @@ inline bool input(float x, float y, float w, float h, InputState& inputState, co
     const Color& inputColor = isActive ? THEME_INPUT_ACTIVE : THEME_INPUT;
     drawRect(x, y, w, h, inputColor);
     
-    // Enable scissor test for text clipping
-    glEnable(GL_SCISSOR_TEST);
-    int windowW, windowH;
-    glfwGetWindowSize(ctx.window, &windowW, &windowH);
-    glScissor((int)(x + padX), windowH - (int)(y + h - padY), (int)textAreaW, (int)(h - 2 * padY));
+    // Clip text to the padded field area
+    pushClipRect(x + padX, y + padY, textAreaW, h - 2 * padY);
 
     // Draw selection (behind text)
     if (isActive && hasSelection(&inputState)) {
@@ -653,25 +5177,39 @@ inline bool input(float x, float y, float w, float h, InputState& inputState, co
         drawRect(selX0, y + padY, selX1 - selX0, lineH, THEME_SELECTION);
     }
 
-    // Draw text or hint
-    if (inputState.text[0] != 0) {
-        label(x + padX - inputState.scrollOffset, y + padY, inputState.text, s, THEME_TEXT);
+    // Draw text or hint. Only the bytes inside the field are copied out and
+    // laid out, so long texts cost no more than the field is wide.
+    if (len > 0) {
+        float viewEnd = inputState.scrollOffset + textAreaW;
+        int first = firstPast(inputState.scrollOffset, false) - 1;
+        int last = firstPast(viewEnd, true);
+        first = std::max(0, first);
+        last = std::min(len, last);
+        while (first > 0 && (inputState.at(first) & 0xC0) == 0x80) --first;        // whole UTF-8 sequences
+        while (last < len && (inputState.at(last) & 0xC0) == 0x80) ++last;
+        // Zero-width bytes at the edges can make the range empty
+        if (first < last) {
+            inputState.visibleText.resize(last - first);
+            inputState.copyText(first, last, &inputState.visibleText[0]);
+            label(x + padX + caretXAt(first) - inputState.scrollOffset, y + padY, inputState.visibleText.c_str(), s, THEME_TEXT);
+        }
     } else if (hint[0] != 0 && !isActive) {
         label(x + padX, y + padY, hint, s, THEME_TEXT_DIM);
     }
 
-    // Draw caret (blinking)
+    // Draw caret (blinking); waitEvents() wakes up for the next toggle
     if (isActive) {
-        double t = glfwGetTime();
-        bool showCaret = fmod(t - inputState.blinkStart, 1.0) < 0.5;
+        double t = getTime();
+        double phase = fmod(t - inputState.blinkStart, 1.0);
+        bool showCaret = phase < 0.5;
+        requestRedrawAt(t + (showCaret ? 0.5 - phase : 1.0 - phase));
         if (showCaret) {
             float cx = x + padX + caretXAt(inputState.caret) - inputState.scrollOffset;
             drawLine(cx, y + padY, cx, y + padY + lineH, THEME_TEXT);
         }
     }
     
-    // Disable scissor test
-    glDisable(GL_SCISSOR_TEST);
+    popClipRect();
     
     // Draw input border
     drawRectOutline(x, y, w, h, isActive ? THEME_TEXT : THEME_TEXT_DIM, 1.0f);
@@ -679,10 +5217,287 @@ inline bool input(float x, float y, float w, float h, InputState& inputState, co
     return isActive;
 }
 
+// ==================== Text Area ====================
+// Measure line bytes [start, end) of a text area, `start` being at `x`, calling
+// visit(pos, byte, x, width) for each until it returns false. The bytes are
+// copied out of the rope a block at a time, so walking stops paying as soon
+// as it stops. Returns the x reached.
+template <class Visit>
+inline double walkTextAreaLine(const TextRope& text, size_t start, size_t end, float scale, double x, Visit visit) {
+    std::string block;
+    for (size_t pos = start; pos < end; ) {
+        size_t n = std::min<size_t>(end - pos, 256);
+        block.clear();
+        text.copy(pos, std::min(end, pos + n + 3), block);  // whole UTF-8 sequences at the block edge
+        for (size_t i = 0; i < n; ++i) {
+            float w = charWidthAt(block.c_str(), (int)i, scale);
+            if (!visit(pos + i, block[i], x, w)) return x;
+            x += w;
+        }
+        pos += n;
+    }
+    return x;
+}
+
+// The last checkpoint of line [start, end) at or before both byte `pos` and x
+// `atX`: returns its byte and sets `x`. Checkpoints are laid down the first
+// time a walk passes them, so after that no lookup walks more than about
+// TINYGUI_LINE_MARK_BYTES. Short lines have none and answer their start.
+inline size_t textAreaMark(TextAreaState& state, size_t start, size_t end, size_t pos, double atX, float scale, double& x) {
+    Context& ctx = getCurrentContext();
+    x = 0.0;
+    if (end - start <= TINYGUI_LINE_MARK_BYTES) return start;
+    int font = ctx.font ? ctx.font->id : 0;
+    if (state.marksRevision != state.text.revision() || state.marksFont != font || state.marksScale != scale) {
+        state.lineMarks.clear();
+        state.marksRevision = state.text.revision();
+        state.marksFont = font;
+        state.marksScale = scale;
+    }
+    auto found = state.lineMarks.find(start);
+    if (found == state.lineMarks.end()) {
+        if (state.lineMarks.size() >= TINYGUI_MARKED_LINES) {
+            auto oldest = state.lineMarks.begin();
+            for (auto it = state.lineMarks.begin(); it != state.lineMarks.end(); ++it)
+                if (it->second.used < oldest->second.used) oldest = it;
+            state.lineMarks.erase(oldest);
+        }
+        found = state.lineMarks.emplace(start, TextAreaState::LineMarks()).first;
+        found->second.offset.push_back(0);
+        found->second.x.push_back(0.0);
+    }
+    TextAreaState::LineMarks& marks = found->second;
+    marks.used = ++state.marksClock;
+
+    // Lay down checkpoints until the next one would pass `pos` or `atX`
+    size_t limit = std::min(std::max(pos, start), end) - start;
+    auto wanted = [&]() { return marks.offset.back() + TINYGUI_LINE_MARK_BYTES <= limit && marks.x.back() <= atX; };
+    if (wanted()) {
+        walkTextAreaLine(state.text, start + marks.offset.back(), end, scale, marks.x.back(), [&](size_t p, char c, double cx, float) {
+            size_t offset = p - start;
+            if (offset < marks.offset.back() + TINYGUI_LINE_MARK_BYTES || (c & 0xC0) == 0x80) return true;
+            marks.offset.push_back(offset);
+            marks.x.push_back(cx);
+            return wanted();
+        });
+    }
+    size_t i = std::min(std::upper_bound(marks.offset.begin(), marks.offset.end(), limit) - marks.offset.begin(),
+                        std::upper_bound(marks.x.begin(), marks.x.end(), atX) - marks.x.begin());
+    if (i == 0) return start;
+    x = marks.x[i - 1];
+    return start + marks.offset[i - 1];
+}
+
+inline double textAreaXAt(TextAreaState& state, size_t line, size_t pos, float scale) {
+    size_t start = state.text.lineStart(line);
+    size_t end = std::min(pos, state.text.lineEnd(line));
+    double x;
+    size_t from = textAreaMark(state, start, state.text.lineEnd(line), end, DBL_MAX, scale, x);
+    return walkTextAreaLine(state.text, from, end, scale, x, [](size_t, char, double, float) { return true; });
+}
+
+// Byte of `line` whose caret position is closest to `x`
+inline size_t textAreaIndexAtX(TextAreaState& state, size_t line, double x, float scale) {
+    size_t start = state.text.lineStart(line);
+    size_t end = state.text.lineEnd(line);
+    size_t found = end;
+    double fromX;
+    size_t from = textAreaMark(state, start, end, end, x, scale, fromX);
+    walkTextAreaLine(state.text, from, end, scale, fromX, [&](size_t pos, char c, double cx, float w) {
+        if ((c & 0xC0) == 0x80 || x >= cx + w * 0.5f) return true;
+        found = pos;
+        return false;
+    });
+    return found;
+}
+
+// Multi-line editor for documents of any size. Only the lines inside the box
+// are looked up (one treap descent each) and laid out, and long lines are
+// measured from their nearest x checkpoint, so drawing, scrolling and typing
+// cost the same for a 10-line note and a 50 MB log, even a single-line one.
+// Only the first visit to the far end of a long line walks out to it.
+// Apps forward mouse-wheel input through onScroll().
+inline bool textArea(float x, float y, float w, float h, TextAreaState& state, const char* hint = "") {
+    Context& ctx = getCurrentContext();
+    bool inside = pointInRect(ctx.mouseX, ctx.mouseY, x, y, w, h);
+    bool isActive = (ctx.activeTextArea == &state);
+    state.caret = std::min(state.caret, state.text.size());
+    state.selAnchor = std::min(state.selAnchor, state.text.size());
+    bool shiftDown = isKeyDown(GLFW_KEY_LEFT_SHIFT) || isKeyDown(GLFW_KEY_RIGHT_SHIFT);
+
+    const float s = TINYGUI_LABEL_SCALE;
+    const float padX = 5.0f, padY = 5.0f;
+    const float lineH = textLineHeight(s);
+    const float caretH = textGlyphHeight(s);
+    const float barW = 8.0f;
+    const float viewW = w - 2 * padX - barW;
+    const float viewH = h - 2 * padY;
+
+    size_t lines = state.text.lineCount();
+    double docH = lines * (double)lineH;
+    double maxScroll = std::max(0.0, docH - viewH);
+    state.pageLines = std::max(1, (int)(viewH / lineH));
+
+    // Scrollbar thumb, sized by the visible share of the document
+    float barX = x + w - barW - 2.0f;
+    float thumbH = docH > viewH ? std::max(20.0f, (float)(viewH * viewH / docH)) : viewH;
+    auto thumbY = [&]() { return y + padY + (maxScroll > 0 ? (float)(state.scrollY / maxScroll) * (viewH - thumbH) : 0.0f); };
+    bool onBar = pointInRect(ctx.mouseX, ctx.mouseY, barX, y + padY, barW, viewH);
+
+    auto lineAtY = [&](float mouseY) -> size_t {
+        double docY = mouseY - (y + padY) + state.scrollY;
+        if (docY <= 0.0) return 0;
+        return std::min(lines - 1, (size_t)(docY / lineH));
+    };
+    auto indexAt = [&](float mouseX, float mouseY) -> size_t {
+        return textAreaIndexAtX(state, lineAtY(mouseY), mouseX - (x + padX) + state.scrollX, s);
+    };
+
+    if (ctx.mousePressed && inside) {
+        ctx.activeTextArea = &state;
+        ctx.activeInput = nullptr;
+        isActive = true;
+        if (onBar && docH > viewH) {
+            float ty = thumbY();
+            state.draggingThumb = true;
+            // Clicking the track centres the thumb under the mouse
+            state.thumbGrab = (ctx.mouseY >= ty && ctx.mouseY < ty + thumbH) ? ctx.mouseY - ty : thumbH * 0.5f;
+        } else {
+            size_t pos = indexAt(ctx.mouseX, ctx.mouseY);
+            if (!shiftDown) state.selAnchor = pos;
+            state.caret = pos;
+            state.selecting = true;
+            state.goalX = -1.0;
+        }
+        if (ctx.window) glfwFocusWindow(ctx.window);
+        state.blinkStart = getTime();
+    } else if (ctx.mousePressed && !inside && isActive) {
+        ctx.activeTextArea = nullptr;
+        isActive = false;
+        state.selecting = false;
+    } else if (!ctx.mouseDown) {
+        state.selecting = false;
+        state.draggingThumb = false;
+    }
+
+    // Wheel: three lines a notch, eased below
+    if (inside && (ctx.wheelY != 0.0f || ctx.wheelX != 0.0f)) {
+        state.scrollTargetY -= ctx.wheelY * 3.0f * lineH;
+        state.scrollX = std::max(0.0, state.scrollX - ctx.wheelX * 3.0 * lineH);
+    }
+
+    if (state.draggingThumb) {
+        float t = (ctx.mouseY - state.thumbGrab - (y + padY)) / std::max(1.0f, viewH - thumbH);
+        state.scrollTargetY = state.scrollY = std::max(0.0f, std::min(1.0f, t)) * maxScroll;
+    } else if (isActive && state.selecting) {
+        // Dragging past the edges scrolls
+        if (ctx.mouseY < y) state.scrollTargetY -= lineH;
+        else if (ctx.mouseY > y + h) state.scrollTargetY += lineH;
+        if (ctx.mouseY < y || ctx.mouseY > y + h) requestAnimationFrame();
+        state.caret = indexAt(ctx.mouseX, ctx.mouseY);
+        state.blinkStart = getTime();
+    }
+
+    // Keyboard edits and moves ask to keep the caret on screen
+    size_t caretLine = state.text.lineOf(state.caret);
+    double caretX = textAreaXAt(state, caretLine, state.caret, s);
+    if (state.followCaret) {
+        double top = caretLine * (double)lineH;
+        if (top < state.scrollTargetY) state.scrollTargetY = top;
+        else if (top + lineH > state.scrollTargetY + viewH) state.scrollTargetY = top + lineH - viewH;
+        state.scrollTargetY = std::max(0.0, std::min(state.scrollTargetY, maxScroll));
+        state.scrollY = state.scrollTargetY;
+        if (caretX < state.scrollX + 10) state.scrollX = std::max(0.0, caretX - 10);
+        else if (caretX > state.scrollX + viewW - 10) state.scrollX = caretX - viewW + 10;
+        state.followCaret = false;
+    }
+
+    // Ease toward the wheel's target; the per-frame cost doesn't depend on
+    // how far it goes
+    state.scrollTargetY = std::max(0.0, std::min(state.scrollTargetY, maxScroll));
+    double now = getTime();
+    double step = std::min(1.0, std::max(0.0, now - state.scrollTime) * 15.0);
+    state.scrollTime = now;
+    state.scrollY = std::min(state.scrollY, maxScroll);
+    if (std::fabs(state.scrollTargetY - state.scrollY) < 0.5) state.scrollY = state.scrollTargetY;
+    else {
+        state.scrollY += (state.scrollTargetY - state.scrollY) * step;
+        requestAnimationFrame();
+    }
+
+    drawRect(x, y, w, h, isActive ? THEME_INPUT_ACTIVE : THEME_INPUT);
+    pushClipRect(x + padX, y + padY, viewW, viewH);
+
+    size_t selA = std::min(state.selAnchor, state.caret);
+    size_t selB = std::max(state.selAnchor, state.caret);
+    bool hasSel = isActive && selA != selB;
+    size_t first = (size_t)(state.scrollY / lineH);
+    size_t last = std::min(lines, (size_t)((state.scrollY + viewH) / lineH) + 1);
+
+    if (state.text.size() == 0 && hint[0] != 0 && !isActive) {
+        label(x + padX, y + padY, hint, s, THEME_TEXT_DIM);
+    }
+    for (size_t line = first; line < last && state.text.size() > 0; ++line) {
+        size_t start = state.text.lineStart(line);
+        size_t end = state.text.lineEnd(line);
+        float ly = y + padY + (float)(line * (double)lineH - state.scrollY);
+        double left = state.scrollX, right = state.scrollX + viewW;
+
+        // One walk, from the checkpoint left of the view, finds the visible
+        // bytes and the selection edges on this line
+        state.lineText.clear();
+        double fromX;
+        size_t from = textAreaMark(state, start, end, end, left, s, fromX);
+        double textX = 0.0, selX0 = -1.0, selX1 = -1.0;
+        bool started = false;
+        double endX = walkTextAreaLine(state.text, from, end, s, fromX, [&](size_t pos, char c, double cx, float cw) {
+            if (pos == selA) selX0 = cx;
+            if (pos == selB) selX1 = cx;
+            if (cx >= right && (c & 0xC0) != 0x80) return false;
+            if (!started && cx + cw > left) { started = true; textX = cx; }
+            if (started) state.lineText += c;
+            return true;
+        });
+        if (hasSel && selA <= end && selB > start) {
+            // Edges before the walk lie left of the view, the ones it didn't
+            // reach past its right
+            if (selA < from) selX0 = fromX;
+            else if (selX0 < 0.0) selX0 = endX;
+            if (selB > end) selX1 = endX + 4.0f * s;   // the selected line break
+            else if (selB < from) selX1 = fromX;
+            else if (selX1 < 0.0) selX1 = endX;
+            drawRect(x + padX + (float)(selX0 - state.scrollX), ly, (float)(selX1 - selX0), caretH, THEME_SELECTION);
+        }
+        if (!state.lineText.empty()) label(x + padX + (float)(textX - state.scrollX), ly, state.lineText.c_str(), s, THEME_TEXT);
+    }
+
+    // Caret (blinking); waitEvents() wakes up for the next toggle
+    if (isActive && caretLine >= first && caretLine < last) {
+        double phase = fmod(now - state.blinkStart, 1.0);
+        bool showCaret = phase < 0.5;
+        requestRedrawAt(now + (showCaret ? 0.5 - phase : 1.0 - phase));
+        if (showCaret) {
+            float cx = x + padX + (float)(caretX - state.scrollX);
+            float cy = y + padY + (float)(caretLine * (double)lineH - state.scrollY);
+            drawLine(cx, cy, cx, cy + caretH, THEME_TEXT);
+        }
+    }
+    popClipRect();
+
+    if (docH > viewH) {
+        drawRect(barX, y + padY, barW, viewH, THEME_BG);
+        drawRect(barX, thumbY(), barW, thumbH, state.draggingThumb || onBar ? THEME_TEXT : THEME_TEXT_DIM);
+    }
+    drawRectOutline(x, y, w, h, isActive ? THEME_TEXT : THEME_TEXT_DIM, 1.0f);
+
+    return isActive;
+}
+
 // ==================== Additional Widgets ====================
 
 // Checkbox widget
 inline bool checkbox(float x, float y, float size, const char* text, bool& checked) {
+    Context& ctx = getCurrentContext();
     bool hovered = pointInRect(ctx.mouseX, ctx.mouseY, x, y, size, size);
     
     if (hovered && ctx.mousePressed) {
@@ -711,6 +5526,7 @@ inline bool checkbox(float x, float y, float size, const char* text, bool& check
 
 // Slider widget
 inline bool slider(float x, float y, float w, float h, float& value, float minValue = 0.0f, float maxValue = 1.0f) {
+    Context& ctx = getCurrentContext();
     bool hovered = pointInRect(ctx.mouseX, ctx.mouseY, x, y, w, h);
     bool dragging = hovered && ctx.mouseDown;
     
@@ -721,11 +5537,6 @@ inline bool slider(float x, float y, float w, float h, float& value, float minVa
         value = minValue + t * (maxValue - minValue);
     }
     
-    // Ensure proper OpenGL state for drawing
-    glDisable(GL_TEXTURE_2D);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
     // Draw track
     float trackY = y + h * 0.4f;
     float trackH = h * 0.2f;
@@ -751,11 +5562,6 @@ inline bool slider(float x, float y, float w, float h, float& value, float minVa
 inline void progressBar(float x, float y, float w, float h, float progress, const Color& fillColor = COLOR_GREEN) {
     progress = std::max(0.0f, std::min(1.0f, progress));
     
-    // Ensure proper OpenGL state for drawing
-    glDisable(GL_TEXTURE_2D);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
     // Draw background
     drawRect(x, y, w, h, THEME_INPUT);
     
@@ -771,6 +5577,7 @@ inline void progressBar(float x, float y, float w, float h, float progress, cons
 // ==================== List & Dropdown Widgets ====================
 // List box widget
 inline int listBox(float x, float y, float w, float h, const char** items, int itemCount, int& selectedIndex) {
+    Context& ctx = getCurrentContext();
     if (itemCount <= 0) return -1;
     
     // Draw list background
@@ -781,11 +5588,8 @@ inline int listBox(float x, float y, float w, float h, const char** items, int i
     int visibleItems = (int)(h / itemHeight);
     int clickedItem = -1;
     
-    // Enable clipping
-    glEnable(GL_SCISSOR_TEST);
-    int windowW, windowH;
-    glfwGetWindowSize(ctx.window, &windowW, &windowH);
-    glScissor((int)x, windowH - (int)(y + h), (int)w, (int)h);
+    // Clip items to the list area
+    pushClipRect(x, y, w, h);
     
     for (int i = 0; i < itemCount && i < visibleItems; i++) {
         float itemY = y + i * itemHeight;
@@ -809,12 +5613,13 @@ inline int listBox(float x, float y, float w, float h, const char** items, int i
         }
     }
     
-    glDisable(GL_SCISSOR_TEST);
+    popClipRect();
     return clickedItem;
 }
 
 // Dropdown widget
 inline int dropdown(float x, float y, float w, float h, const char** items, int itemCount, int& selectedIndex, bool& isOpen) {
+    Context& ctx = getCurrentContext();
     if (itemCount <= 0) return -1;
     
     // Main dropdown button
@@ -852,11 +5657,8 @@ inline int dropdown(float x, float y, float w, float h, const char** items, int
         drawRect(x, listY, w, listH, THEME_INPUT);
         drawRectOutline(x, listY, w, listH, THEME_TEXT, 1.0f);
         
-        // Enable clipping for list
-        glEnable(GL_SCISSOR_TEST);
-        int windowW, windowH;
-        glfwGetWindowSize(ctx.window, &windowW, &windowH);
-        glScissor((int)x, windowH - (int)(listY + listH), (int)w, (int)listH);
+        // Clip items to the list area
+        pushClipRect(x, listY, w, listH);
         
         for (int i = 0; i < itemCount; i++) {
             float itemY = listY + i * 25.0f;
@@ -881,7 +5683,7 @@ inline int dropdown(float x, float y, float w, float h, const char** items, int
             }
         }
         
-        glDisable(GL_SCISSOR_TEST);
+        popClipRect();
         
         // Close dropdown if clicked outside
         if (ctx.mousePressed && !pointInRect(ctx.mouseX, ctx.mouseY, x, y, w, h + listH)) {
@@ -902,6 +5704,7 @@ inline int simpleDropdown(float x, float y, float w, float h, const char** items
 
 // Set layout starting position and direction
 inline void beginLayout(float x, float y, bool vertical = true, float spacing = 8.0f) {
+    Context& ctx = getCurrentContext();
     ctx.layoutX = x;
     ctx.layoutY = y;
     ctx.layoutVertical = vertical;
@@ -910,12 +5713,14 @@ inline void beginLayout(float x, float y, bool vertical = true, float spacing =
 
 // Get current layout position
 inline void getLayoutPos(float& x, float& y) {
+    Context& ctx = getCurrentContext();
     x = ctx.layoutX;
     y = ctx.layoutY;
 }
 
 // Advance layout position
 inline void advanceLayout(float w, float h) {
+    Context& ctx = getCurrentContext();
     if (ctx.layoutVertical) {
         ctx.layoutY += h + ctx.layoutSpacing;
     } else {
@@ -925,6 +5730,7 @@ inline void advanceLayout(float w, float h) {
 
 // Layout-aware button
 inline bool buttonLayout(float w, float h, const char* text) {
+    Context& ctx = getCurrentContext();
     bool result = button(ctx.layoutX, ctx.layoutY, w, h, text);
     advanceLayout(w, h);
     return result;
@@ -932,6 +5738,7 @@ inline bool buttonLayout(float w, float h, const char* text) {
 
 // Layout-aware label
 inline void labelLayout(const char* text, float scale = TINYGUI_LABEL_SCALE, const Color& color = THEME_TEXT) {
+    Context& ctx = getCurrentContext();
     label(ctx.layoutX, ctx.layoutY, text, scale, color);
     float h = measureTextHeight(text, scale);
     advanceLayout(0, h);
@@ -939,13 +5746,22 @@ inline void labelLayout(const char* text, float scale = TINYGUI_LABEL_SCALE, con
 
 // Layout-aware input
 inline bool inputLayout(float w, float h, InputState& inputState, const char* hint = "") {
+    Context& ctx = getCurrentContext();
     bool result = input(ctx.layoutX, ctx.layoutY, w, h, inputState, hint);
     advanceLayout(w, h);
     return result;
 }
 
+inline bool textAreaLayout(float w, float h, TextAreaState& state, const char* hint = "") {
+    Context& ctx = getCurrentContext();
+    bool result = textArea(ctx.layoutX, ctx.layoutY, w, h, state, hint);
+    advanceLayout(w, h);
+    return result;
+}
+
 // Layout-aware checkbox
 inline bool checkboxLayout(float size, const char* text, bool& checked) {
+    Context& ctx = getCurrentContext();
     bool result = checkbox(ctx.layoutX, ctx.layoutY, size, text, checked);
     advanceLayout(size + (text ? measureTextWidth(text) + 8 : 0), size);
     return result;
@@ -953,6 +5769,7 @@ inline bool checkboxLayout(float size, const char* text, bool& checked) {
 
 // Layout-aware slider
 inline bool sliderLayout(float w, float h, float& value, float minValue = 0.0f, float maxValue = 1.0f) {
+    Context& ctx = getCurrentContext();
     bool result = slider(ctx.layoutX, ctx.layoutY, w, h, value, minValue, maxValue);
     advanceLayout(w, h);
     return result;
@@ -960,6 +5777,7 @@ inline bool sliderLayout(float w, float h, float& value, float minValue = 0.0f,
 
 // Add spacing to layout
 inline void layoutSpacing(float space = -1.0f) {
+    Context& ctx = getCurrentContext();
     if (space < 0) space = ctx.layoutSpacing;
     if (ctx.layoutVertical) {
         ctx.layoutY += space;
@@ -981,18 +5799,17 @@ struct MenuItem {
 };
 
 // Menu positions storage
-static float menuPositions[10]; // Support up to 10 menus
 
 // Draw menu bar
 inline bool menuBar(const char** menuTitles, int menuCount) {
+    Context& ctx = getCurrentContext();
     if (!ctx.menuBarVisible) return false;
     
-    int windowW, windowH;
-    glfwGetWindowSize(ctx.window, &windowW, &windowH);
+    float windowW = (float)ctx.displayW;
     
     // Draw menu bar background
-    drawRect(0, 0, (float)windowW, ctx.menuBarHeight, THEME_BUTTON);
-    drawLine(0, ctx.menuBarHeight, (float)windowW, ctx.menuBarHeight, THEME_TEXT, 1.0f);
+    drawRect(0, 0, windowW, ctx.menuBarHeight, THEME_BUTTON);
+    drawLine(0, ctx.menuBarHeight, windowW, ctx.menuBarHeight, THEME_TEXT, 1.0f);
     
     float currentX = 10.0f;
     bool menuClicked = false;
@@ -1002,7 +5819,7 @@ inline bool menuBar(const char** menuTitles, int menuCount) {
         float menuW = textW + 20.0f;
         
         // Store menu position for dropdown alignment
-        menuPositions[i] = currentX;
+        ctx.menuPositions[i] = currentX;
         
         bool hovered = pointInRect(ctx.mouseX, ctx.mouseY, currentX, 0, menuW, ctx.menuBarHeight);
         bool isActive = (ctx.activeMenu == i);
@@ -1038,6 +5855,7 @@ inline bool menuBar(const char** menuTitles, int menuCount) {
 
 // Draw dropdown menu
 inline int dropdownMenu(float x, float y, MenuItem* items, int itemCount) {
+    Context& ctx = getCurrentContext();
     if (ctx.activeMenu == -1) return -1;
     
     float menuW = 150.0f;
@@ -1087,6 +5905,7 @@ inline void standardMenuBarOnly() {
 
 // Draw dropdown menus - call this AFTER all other GUI elements
 inline int standardMenuDropdowns() {
+    Context& ctx = getCurrentContext();
     static MenuItem fileMenu[] = {
         MenuItem("New", true),
         MenuItem("Open", true),
@@ -1116,19 +5935,19 @@ inline int standardMenuDropdowns() {
     
     switch (ctx.activeMenu) {
         case 0: // File menu
-            result = dropdownMenu(menuPositions[0], ctx.menuBarHeight + 1, fileMenu, 5);
+            result = dropdownMenu(ctx.menuPositions[0], ctx.menuBarHeight + 1, fileMenu, 5);
             if (result >= 0) result += 100; // File menu items: 100-104
             break;
         case 1: // Edit menu
-            result = dropdownMenu(menuPositions[1], ctx.menuBarHeight + 1, editMenu, 6);
+            result = dropdownMenu(ctx.menuPositions[1], ctx.menuBarHeight + 1, editMenu, 6);
             if (result >= 0) result += 200; // Edit menu items: 200-205
             break;
         case 2: // View menu
-            result = dropdownMenu(menuPositions[2], ctx.menuBarHeight + 1, viewMenu, 3);
+            result = dropdownMenu(ctx.menuPositions[2], ctx.menuBarHeight + 1, viewMenu, 3);
             if (result >= 0) result += 300; // View menu items: 300-302
             break;
         case 3: // Help menu
-            result = dropdownMenu(menuPositions[3], ctx.menuBarHeight + 1, helpMenu, 2);
+            result = dropdownMenu(ctx.menuPositions[3], ctx.menuBarHeight + 1, helpMenu, 2);
             if (result >= 0) result += 400; // Help menu items: 400-401
             break;
     }
@@ -1144,6 +5963,7 @@ inline int standardMenuBar() {
 
 // Get menu bar height (for adjusting content position)
 inline float getMenuBarHeight() {
+    Context& ctx = getCurrentContext();
     return ctx.menuBarVisible ? ctx.menuBarHeight : 0.0f;
 }
 
@@ -1157,6 +5977,7 @@ inline int easyMenuBar() {
 // ==================== Function Implementations ====================
 // Modal Dialog implementations
 inline void alert(const char* title, const char* message) {
+    Context& ctx = getCurrentContext();
     strncpy(ctx.modal.title, title, sizeof(ctx.modal.title) - 1);
     strncpy(ctx.modal.message, message, sizeof(ctx.modal.message) - 1);
     ctx.modal.type = 0; // Alert
@@ -1165,6 +5986,7 @@ inline void alert(const char* title, const char* message) {
 }
 
 inline bool confirm(const char* title, const char* message) {
+    Context& ctx = getCurrentContext();
     if (!ctx.modal.visible) {
         strncpy(ctx.modal.title, title, sizeof(ctx.modal.title) - 1);
         strncpy(ctx.modal.message, message, sizeof(ctx.modal.message) - 1);
@@ -1176,21 +5998,19 @@ inline bool confirm(const char* title, const char* message) {
 }
 
 inline bool isModalVisible() {
+    Context& ctx = getCurrentContext();
     return ctx.modal.visible;
 }
 
 inline void drawModalDialog() {
+    Context& ctx = getCurrentContext();
     if (!ctx.modal.visible) return;
     
-    int windowW, windowH;
-    glfwGetWindowSize(ctx.window, &windowW, &windowH);
-    
-    // Draw overlay
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    float windowW = (float)ctx.displayW, windowH = (float)ctx.displayH;
     
+    // Draw overlay (alpha blended at submission)
     Color overlay(0.0f, 0.0f, 0.0f, 0.5f);
-    drawRect(0, 0, (float)windowW, (float)windowH, overlay);
+    drawRect(0, 0, windowW, windowH, overlay);
     
     // Dialog dimensions
     float dialogW = 400.0f;
@@ -1234,16 +6054,15 @@ inline void drawModalDialog() {
         }
     }
     
-    if (glfwGetKey(ctx.window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    if (isKeyDown(GLFW_KEY_ESCAPE)) {
         ctx.modal.visible = false;
         ctx.modal.result = 2;
     }
-    
-    glDisable(GL_BLEND);
 }
 
 // Image system implementations
 inline void image(float x, float y, float w, float h, const char* name) {
+    Context& ctx = getCurrentContext();
     auto it = ctx.imageCache.find(name);
     if (it == ctx.imageCache.end() || !it->second.loaded) {
         drawRect(x, y, w, h, COLOR_DARK_GRAY);
@@ -1253,26 +6072,14 @@ inline void image(float x, float y, float w, float h, const char* name) {
     }
     
     ImageData& img = it->second;
-    
-    glEnable(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, img.textureID);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    
-    glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-    glBegin(GL_QUADS);
-    glTexCoord2f(0.0f, 0.0f); glVertex2f(x, y);
-    glTexCoord2f(1.0f, 0.0f); glVertex2f(x + w, y);
-    glTexCoord2f(1.0f, 1.0f); glVertex2f(x + w, y + h);
-    glTexCoord2f(0.0f, 1.0f); glVertex2f(x, y + h);
-    glEnd();
-    
-    glDisable(GL_BLEND);
-    glDisable(GL_TEXTURE_2D);
+    if (isClipped(x, y, w, h)) return;
+    Vertex* v = ctx.drawList.alloc(PRIM_QUADS, 4, img.textureID);
+    setQuad(v, x, y, x + w, y + h, 0.0f, 0.0f, 1.0f, 1.0f, COLOR_WHITE);
 }
 
 // Tab system implementations
 inline int tabBar(float x, float y, float w, float h, const char** tabNames, int tabCount, int& activeTab) {
+    Context& ctx = getCurrentContext();
     if (tabCount <= 0) return -1;
     
     float tabWidth = w / tabCount;
@@ -1292,9 +6099,10 @@ inline int tabBar(float x, float y, float w, float h, const char** tabNames, int
             drawRectOutline(tabX, y, tabWidth, h, THEME_TEXT_DIM, 1.0f);
         }
         
-        float textW = measureTextWidth(tabNames[i], 1.8f);
+        float textW, textH;
+        measureText(tabNames[i], 1.8f, textW, textH);
         float textX = tabX + (tabWidth - textW) * 0.5f;
-        float textY = y + (h - measureTextHeight(tabNames[i], 1.8f)) * 0.5f;
+        float textY = y + (h - textH) * 0.5f;
         label(textX, textY, tabNames[i], 1.8f, THEME_TEXT);
         
         if (hovered && ctx.mousePressed) {
@@ -1310,50 +6118,217 @@ inline void beginTabContent(float x, float y, float w, float h) {
     drawRect(x, y, w, h, THEME_INPUT);
     drawRectOutline(x, y, w, h, THEME_TEXT, 1.0f);
     
-    glEnable(GL_SCISSOR_TEST);
-    int windowW, windowH;
-    glfwGetWindowSize(ctx.window, &windowW, &windowH);
-    glScissor((int)x, windowH - (int)(y + h), (int)w, (int)h);
+    pushClipRect(x, y, w, h);
 }
 
 inline void endTabContent() {
-    glDisable(GL_SCISSOR_TEST);
+    popClipRect();
 }
 
 // Define endFrame here after menu functions are available
 inline void endFrame() { 
+    Context& ctx = getCurrentContext();
+    // Overlays are never clipped by regions the app left open
+    while (!ctx.clipStack.empty()) popClipRect();
+    
     // Automatically draw dropdown menus at the end of frame
     ctx.pendingMenuResult = standardMenuDropdowns();
     
     // Draw modal dialogs on top of everything
     drawModalDialog();
+    ctx.wheelX = ctx.wheelY = 0.0f;  // this frame's widgets have seen it
     
-    glfwSwapBuffers(ctx.window); 
+    submitDrawList();
+    if (!ctx.stats.skipped) ctx.renderer->present();
+    if (ctx.readbackRequested || ctx.captureFrames) {
+        ctx.renderer->readback(ctx.frameCount);
+        ctx.readbackRequested = false;
+    }
+    ++ctx.frameCount;
+    if (ctx.captureFrames || !ctx.screenshotPaths.empty()) collectFrameReadbacks(false);
 }
 
 // ==================== Character and Key handling ====================
 inline void addCharToInput(unsigned int codepoint) {
+    Context& ctx = getCurrentContext();
     if (!ctx.activeInput) return;
     if (codepoint < 32 || codepoint > 126) return; // printable ASCII only
     if (hasSelection(ctx.activeInput)) deleteSelectionRange(ctx.activeInput);
 
-    int len = textLen(ctx.activeInput);
-    if (len >= TINYGUI_MAX_TEXT - 1) return;
-
     int pos = clampIndex(ctx.activeInput->caret, ctx.activeInput);
-    std::memmove(ctx.activeInput->text + pos + 1, ctx.activeInput->text + pos, (size_t)(len - pos + 1)); // includes null
-    ctx.activeInput->text[pos] = (char)codepoint;
+    char c[2] = {(char)codepoint, 0};
+    insertInputText(ctx.activeInput, pos, c);
     ctx.activeInput->caret = ctx.activeInput->selAnchor = pos + 1;
     resetBlink(ctx.activeInput);
 }
 
-inline void onChar(unsigned int codepoint) { addCharToInput(codepoint); }
+// Replace the selection (if any) with `text` and put the caret after it
+inline void pasteToInput(const char* text) {
+    Context& ctx = getCurrentContext();
+    if (!ctx.activeInput || !text) return;
+    if (hasSelection(ctx.activeInput)) deleteSelectionRange(ctx.activeInput);
+
+    // A single-line field keeps everything up to the first line break
+    std::string line(text, std::strcspn(text, "\r\n"));
+    int pos = clampIndex(ctx.activeInput->caret, ctx.activeInput);
+    insertInputText(ctx.activeInput, pos, line.c_str());
+    ctx.activeInput->caret = ctx.activeInput->selAnchor = pos + (int)line.size();
+    resetBlink(ctx.activeInput);
+}
+
+// Replace the selection (if any) with `n` bytes of `text` in the active text area
+inline void insertIntoTextArea(TextAreaState* area, const char* text, size_t n) {
+    size_t a = std::min(area->selAnchor, area->caret);
+    size_t b = std::max(area->selAnchor, area->caret);
+    area->erase(a, b);
+    area->insert(a, text, n);
+    area->caret = area->selAnchor = a + n;
+    area->goalX = -1.0;
+    area->followCaret = true;
+    area->blinkStart = getTime();
+}
+
+inline void addCharToTextArea(unsigned int codepoint) {
+    Context& ctx = getCurrentContext();
+    if (!ctx.activeTextArea) return;
+    if (codepoint < 32 || codepoint > 126) return; // printable ASCII only, as in input()
+    char c = (char)codepoint;
+    insertIntoTextArea(ctx.activeTextArea, &c, 1);
+}
+
+inline void handleTextAreaKey(int key, int action, int mods) {
+    Context& ctx = getCurrentContext();
+    TextAreaState* area = ctx.activeTextArea;
+    if (!area) return;
+    if (!(action == GLFW_PRESS || action == GLFW_REPEAT)) return;
+
+    bool shift = (mods & GLFW_MOD_SHIFT) != 0;
+    bool shortcut = (mods & (GLFW_MOD_CONTROL | GLFW_MOD_SUPER)) != 0;
+    const TextRope& text = area->text;
+    const float s = TINYGUI_LABEL_SCALE;
+    size_t a = std::min(area->selAnchor, area->caret);
+    size_t b = std::max(area->selAnchor, area->caret);
+
+    auto moveTo = [&](size_t pos, bool keepGoal) {
+        pos = std::min(pos, text.size());
+        if (!shift) area->selAnchor = pos;
+        area->caret = pos;
+        if (!keepGoal) area->goalX = -1.0;
+        area->followCaret = true;
+        area->blinkStart = getTime();
+    };
+    // Steps over whole UTF-8 sequences
+    auto prevChar = [&](size_t pos) {
+        if (pos > 0) --pos;
+        while (pos > 0 && (text.at(pos) & 0xC0) == 0x80) --pos;
+        return pos;
+    };
+    auto nextChar = [&](size_t pos) {
+        if (pos < text.size()) ++pos;
+        while (pos < text.size() && (text.at(pos) & 0xC0) == 0x80) ++pos;
+        return pos;
+    };
+    // Up/down keep the x the caret had when the vertical move began
+    auto moveLines = [&](long delta) {
+        size_t line = text.lineOf(area->caret);
+        if (area->goalX < 0.0) area->goalX = textAreaXAt(*area, line, area->caret, s);
+        long target = std::max(0L, std::min((long)text.lineCount() - 1, (long)line + delta));
+        moveTo(textAreaIndexAtX(*area, (size_t)target, area->goalX, s), true);
+    };
+    auto copySelection = [&]() {
+        std::string selected;
+        text.copy(a, b, selected);
+        if (ctx.window) glfwSetClipboardString(ctx.window, selected.c_str());
+    };
+    auto erase = [&](size_t from, size_t to) {
+        area->erase(from, to);
+        area->selAnchor = from;
+        moveTo(from, false);
+    };
+
+    switch (key) {
+        case GLFW_KEY_LEFT:
+            if (a != b && !shift) moveTo(a, false);
+            else moveTo(prevChar(area->caret), false);
+            break;
+        case GLFW_KEY_RIGHT:
+            if (a != b && !shift) moveTo(b, false);
+            else moveTo(nextChar(area->caret), false);
+            break;
+        case GLFW_KEY_UP:        moveLines(-1); break;
+        case GLFW_KEY_DOWN:      moveLines(1); break;
+        case GLFW_KEY_PAGE_UP:   moveLines(-area->pageLines); break;
+        case GLFW_KEY_PAGE_DOWN: moveLines(area->pageLines); break;
+        case GLFW_KEY_HOME:
+            moveTo(shortcut ? 0 : text.lineStart(text.lineOf(area->caret)), false);
+            break;
+        case GLFW_KEY_END:
+            moveTo(shortcut ? text.size() : text.lineEnd(text.lineOf(area->caret)), false);
+            break;
+        case GLFW_KEY_BACKSPACE:
+            if (a != b) erase(a, b);
+            else if (area->caret > 0) erase(prevChar(area->caret), area->caret);
+            break;
+        case GLFW_KEY_DELETE:
+            if (a != b) erase(a, b);
+            else if (area->caret < text.size()) erase(area->caret, nextChar(area->caret));
+            break;
+        case GLFW_KEY_ENTER:
+            insertIntoTextArea(area, "\n", 1);
+            break;
+        case GLFW_KEY_A:
+            if (shortcut) {
+                area->selAnchor = 0;
+                area->caret = text.size();
+                area->blinkStart = getTime();
+            }
+            break;
+        case GLFW_KEY_C:
+            if (shortcut && a != b) copySelection();
+            break;
+        case GLFW_KEY_X:
+            if (shortcut && a != b) {
+                copySelection();
+                erase(a, b);
+            }
+            break;
+        case GLFW_KEY_V:
+            if (shortcut && ctx.window) {
+                const char* clip = glfwGetClipboardString(ctx.window);
+                if (!clip) break;
+                // Line breaks become '\n'
+                std::string pasted;
+                for (const char* p = clip; *p; ++p) {
+                    if (*p != '\r') pasted += *p;
+                    else if (p[1] != '\n') pasted += '\n';
+                }
+                insertIntoTextArea(area, pasted.data(), pasted.size());
+            }
+            break;
+        default: break;
+    }
+}
+
+inline void onChar(unsigned int codepoint) {
+    Context& ctx = getCurrentContext();
+    if (ctx.activeTextArea) addCharToTextArea(codepoint);
+    else addCharToInput(codepoint);
+}
+
+// Mouse wheel offsets, as GLFW's scroll callback reports them
+inline void onScroll(double xoffset, double yoffset) {
+    Context& ctx = getCurrentContext();
+    ctx.wheelX += (float)xoffset;
+    ctx.wheelY += (float)yoffset;
+}
 
 inline void handleKey(int key, int action, int mods) {
+    Context& ctx = getCurrentContext();
     if (!ctx.activeInput) return;
     if (!(action == GLFW_PRESS || action == GLFW_REPEAT)) return;
 
     bool shift = (mods & GLFW_MOD_SHIFT) != 0;
+    bool shortcut = (mods & (GLFW_MOD_CONTROL | GLFW_MOD_SUPER)) != 0;
     int len = textLen(ctx.activeInput);
 
     auto moveTo = [&](int pos) {
@@ -1363,6 +6338,15 @@ inline void handleKey(int key, int action, int mods) {
         resetBlink(ctx.activeInput);
     };
 
+    // Clipboard: the selected bytes, copied out around the gap
+    auto copySelection = [&]() {
+        int a = std::min(ctx.activeInput->selAnchor, ctx.activeInput->caret);
+        int b = std::max(ctx.activeInput->selAnchor, ctx.activeInput->caret);
+        std::string selected(b - a, '\0');
+        ctx.activeInput->copyText(a, b, &selected[0]);
+        if (ctx.window) glfwSetClipboardString(ctx.window, selected.c_str());
+    };
+
     switch (key) {
         case GLFW_KEY_LEFT:
             if (hasSelection(ctx.activeInput) && !shift) moveTo(std::min(ctx.activeInput->selAnchor, ctx.activeInput->caret));
@@ -1378,9 +6362,7 @@ inline void handleKey(int key, int action, int mods) {
             if (hasSelection(ctx.activeInput)) {
                 deleteSelectionRange(ctx.activeInput);
             } else if (ctx.activeInput->caret > 0) {
-                std::memmove(ctx.activeInput->text + ctx.activeInput->caret - 1,
-                             ctx.activeInput->text + ctx.activeInput->caret,
-                             (size_t)(len - ctx.activeInput->caret + 1)); // includes null
+                eraseInputText(ctx.activeInput, ctx.activeInput->caret - 1, ctx.activeInput->caret);
                 ctx.activeInput->caret--; ctx.activeInput->selAnchor = ctx.activeInput->caret;
                 resetBlink(ctx.activeInput);
             }
@@ -1389,18 +6371,37 @@ inline void handleKey(int key, int action, int mods) {
             if (hasSelection(ctx.activeInput)) {
                 deleteSelectionRange(ctx.activeInput);
             } else if (ctx.activeInput->caret < len) {
-                std::memmove(ctx.activeInput->text + ctx.activeInput->caret,
-                             ctx.activeInput->text + ctx.activeInput->caret + 1,
-                             (size_t)(len - ctx.activeInput->caret)); // includes null
+                eraseInputText(ctx.activeInput, ctx.activeInput->caret, ctx.activeInput->caret + 1);
                 resetBlink(ctx.activeInput);
             }
             break;
+        case GLFW_KEY_A:
+            if (shortcut) {
+                ctx.activeInput->selAnchor = 0;
+                ctx.activeInput->caret = len;
+                resetBlink(ctx.activeInput);
+            }
+            break;
+        case GLFW_KEY_C:
+            if (shortcut && hasSelection(ctx.activeInput)) copySelection();
+            break;
+        case GLFW_KEY_X:
+            if (shortcut && hasSelection(ctx.activeInput)) {
+                copySelection();
+                deleteSelectionRange(ctx.activeInput);
+            }
+            break;
+        case GLFW_KEY_V:
+            if (shortcut && ctx.window) pasteToInput(glfwGetClipboardString(ctx.window));
+            break;
         default: break;
     }
 }
 
 inline void onKey(int key, int /*scancode*/, int action, int mods) {
-    handleKey(key, action, mods);
+    Context& ctx = getCurrentContext();
+    if (ctx.activeTextArea) handleTextAreaKey(key, action, mods);
+    else handleKey(key, action, mods);
 }
 
 } // namespace tinygui
\ No newline at end of file